@@ -4,6 +4,9 @@
 // Tabulate the following
 // Image sizes (Width x Height): 512 x 512, 1024 x 1024, 2048 x 2048, 4096 x 4096
 // Schedule types: default, static, dynamic, guided
+// Tile schedules: 2D tiles handed out by an atomic tile queue, in row-major or Z-order (Morton) order
+// Edge pipeline: gray -> Gaussian blur -> Sobel -> threshold, stage by stage or fused per tile
+// Every input is decoded once; decode, compute and encode are timed separately
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -11,134 +14,1065 @@
 #include <gd.h>
 #include <error.h>
 #include <string.h>
+#include <immintrin.h>
+#include <unistd.h>
+#include <math.h>
+#include <zlib.h>
+
+// Grayscale kernel instruction set paths, chosen at startup by detect_isa()
+enum isa_path { ISA_GENERIC, ISA_SSE2, ISA_AVX2, NUM_ISAS };
+static const char *isa_names[NUM_ISAS] = { "generic", "sse2", "avx2" };
+
+// BT.601 luma weights in 8-bit fixed point (they sum to 256, so white stays 255)
+#define LUMA_R 77
+#define LUMA_G 150
+#define LUMA_B 29
+
+// Tint of each thread's rows: red, green, blue, and gray for every other thread
+static const int thread_tints[4] = { 0xFF0000, 0x00FF00, 0x0000FF, 0xFFFFFF };
+
+/**
+ * Converts one row of gd truecolor pixels (0x7FRRGGBB) to gray and writes
+ * gray * 0x010101 masked by `tint` (an opaque truecolor pixel) to dst.
+ */
+typedef void (*gray_row_fn)(const int *src, int *dst, int w, int tint);
+
+static void gray_row_generic(const int *src, int *dst, int w, int tint)
+{
+    for (int x = 0; x < w; x++)
+    {
+        int p = src[x];
+        int gray = (LUMA_R * gdTrueColorGetRed(p) + LUMA_G * gdTrueColorGetGreen(p) + LUMA_B * gdTrueColorGetBlue(p) + 128) >> 8;
+        dst[x] = (gray * 0x010101) & tint;
+    }
+}
+
+// Channels stay in their 32-bit lanes; r * 77 + g * 150 + b * 29 < 2^16, so 16-bit multiplies are exact
+static void gray_row_sse2(const int *src, int *dst, int w, int tint)
+{
+    const __m128i byte = _mm_set1_epi32(0xFF), mask = _mm_set1_epi32(tint);
+    const __m128i wr = _mm_set1_epi32(LUMA_R), wg = _mm_set1_epi32(LUMA_G), wb = _mm_set1_epi32(LUMA_B);
+    const __m128i round = _mm_set1_epi32(128);
+    int x = 0;
+    for (; x + 4 <= w; x += 4)
+    {
+        __m128i p = _mm_loadu_si128((const __m128i *)(src + x));
+        __m128i r = _mm_and_si128(_mm_srli_epi32(p, 16), byte);
+        __m128i g = _mm_and_si128(_mm_srli_epi32(p, 8), byte);
+        __m128i b = _mm_and_si128(p, byte);
+        __m128i sum = _mm_add_epi32(_mm_add_epi32(_mm_mullo_epi16(r, wr), _mm_mullo_epi16(g, wg)),
+                                    _mm_add_epi32(_mm_mullo_epi16(b, wb), round));
+        __m128i gray = _mm_srli_epi32(sum, 8);
+        gray = _mm_or_si128(_mm_or_si128(gray, _mm_slli_epi32(gray, 8)), _mm_slli_epi32(gray, 16));
+        _mm_storeu_si128((__m128i *)(dst + x), _mm_and_si128(gray, mask));
+    }
+    gray_row_generic(src + x, dst + x, w - x, tint);
+}
+
+__attribute__((target("avx2")))
+static void gray_row_avx2(const int *src, int *dst, int w, int tint)
+{
+    const __m256i byte = _mm256_set1_epi32(0xFF), mask = _mm256_set1_epi32(tint);
+    const __m256i wr = _mm256_set1_epi32(LUMA_R), wg = _mm256_set1_epi32(LUMA_G), wb = _mm256_set1_epi32(LUMA_B);
+    const __m256i round = _mm256_set1_epi32(128);
+    int x = 0;
+    for (; x + 8 <= w; x += 8)
+    {
+        __m256i p = _mm256_loadu_si256((const __m256i *)(src + x));
+        __m256i r = _mm256_and_si256(_mm256_srli_epi32(p, 16), byte);
+        __m256i g = _mm256_and_si256(_mm256_srli_epi32(p, 8), byte);
+        __m256i b = _mm256_and_si256(p, byte);
+        __m256i sum = _mm256_add_epi32(_mm256_add_epi32(_mm256_mullo_epi16(r, wr), _mm256_mullo_epi16(g, wg)),
+                                       _mm256_add_epi32(_mm256_mullo_epi16(b, wb), round));
+        __m256i gray = _mm256_srli_epi32(sum, 8);
+        gray = _mm256_or_si256(_mm256_or_si256(gray, _mm256_slli_epi32(gray, 8)), _mm256_slli_epi32(gray, 16));
+        _mm256_storeu_si256((__m256i *)(dst + x), _mm256_and_si256(gray, mask));
+    }
+    gray_row_generic(src + x, dst + x, w - x, tint);
+}
+
+/**
+ * Palette rows: gd palette images store one color index per pixel, so the gray
+ * value of every palette entry is computed once (palette_gray, already
+ * replicated to 0x00GGGGGG) and each pixel is a table lookup.
+ */
+static int palette_gray[gdMaxColors];
+
+static void gray_row_palette(const unsigned char *src, int *dst, int w, int tint)
+{
+    for (int x = 0; x < w; x++)
+    {
+        dst[x] = palette_gray[src[x]] & tint;
+    }
+}
+
+// Fills palette_gray for a palette image
+static void fill_palette_gray(gdImagePtr img)
+{
+    for (int c = 0; c < gdImageColorsTotal(img); c++)
+    {
+        int gray = (LUMA_R * gdImageRed(img, c) + LUMA_G * gdImageGreen(img, c) + LUMA_B * gdImageBlue(img, c) + 128) >> 8;
+        palette_gray[c] = gray * 0x010101;
+    }
+}
+
+static const gray_row_fn gray_kernels[NUM_ISAS] = { gray_row_generic, gray_row_sse2, gray_row_avx2 };
+static enum isa_path active_isa = ISA_GENERIC;
+
+// Width of the self-test row: not a multiple of 8, so the SIMD kernels run their scalar tails
+#define ISA_TEST_WIDTH 1003
+
+/**
+ * Checks that a grayscale kernel matches gray_row_generic bit for bit, for every
+ * thread tint, on a row of hashed pixels. Returns the first mismatching column, or -1.
+ */
+static int isa_self_test(gray_row_fn kernel)
+{
+    static int src[ISA_TEST_WIDTH], expect[ISA_TEST_WIDTH], got[ISA_TEST_WIDTH];
+    for (int x = 0; x < ISA_TEST_WIDTH; x++)
+    {
+        unsigned h = (unsigned)x * 2654435761u;
+        src[x] = (int)((h ^ (h >> 15)) & 0x7FFFFFFF);
+    }
+    // The extremes of every channel go first
+    src[0] = 0x00000000;
+    src[1] = 0x00FFFFFF;
+    src[2] = 0x7FFFFFFF;
+
+    for (int t = 0; t < 4; t++)
+    {
+        gray_row_generic(src, expect, ISA_TEST_WIDTH, thread_tints[t]);
+        kernel(src, got, ISA_TEST_WIDTH, thread_tints[t]);
+        for (int x = 0; x < ISA_TEST_WIDTH; x++)
+            if (got[x] != expect[x])
+                return x;
+    }
+    return -1;
+}
+
+/**
+ * Picks the widest grayscale kernel this CPU supports, or the one named by the
+ * GRAY_ISA environment variable (generic, sse2 or avx2), and checks it against
+ * the generic kernel before any image is processed.
+ */
+static void detect_isa(void)
+{
+    __builtin_cpu_init();
+    active_isa = __builtin_cpu_supports("avx2") ? ISA_AVX2 : ISA_SSE2;
+
+    const char *forced = getenv("GRAY_ISA");
+    if (forced)
+    {
+        int i = 0;
+        while (i < NUM_ISAS && strcmp(forced, isa_names[i]) != 0)
+            i++;
+        if (i == NUM_ISAS)
+            error(1, 0, "GRAY_ISA=%s: expected generic, sse2 or avx2", forced);
+        if (i == ISA_AVX2 && !__builtin_cpu_supports("avx2"))
+            error(1, 0, "GRAY_ISA=avx2: this CPU does not support AVX2");
+        active_isa = i;
+    }
+
+    int x = isa_self_test(gray_kernels[active_isa]);
+    if (x >= 0)
+        error(1, 0, "%s grayscale kernel differs from the generic kernel at column %d", isa_names[active_isa], x);
+}
 
 /**
  * Function: process_pixels
  * -------------------------
- * Converts an image's pixel colors to grayscale while assigning a unique tint
- * to each thread's portion of the image.
+ * Converts one row of an image to grayscale, straight from gd's row buffers,
+ * and tints it by the calling thread so the output shows which thread
+ * processed which rows. Output colors are built arithmetically into a
+ * truecolor image, so threads never allocate colors in a shared palette.
  *
  * Parameters:
- *    img - Pointer to the GD image structure.
- *    x   - Column index to process.
- *    h   - Height of the image (number of rows to process).
+ *    img - Pointer to the input image (truecolor, or palette with palette_gray filled in).
+ *    out - Preallocated truecolor output image of the same size.
+ *    y   - Row index to process.
+ *    x0  - First column to process.
+ *    x1  - One past the last column to process.
  */
-void process_pixels(gdImagePtr img, int x, int h)
+void process_pixels(gdImagePtr img, gdImagePtr out, int y, int x0, int x1)
 {
-    int y, color, red, green, blue, tmp, tid;
-    for (y = 0; y < h; y++)
+    int tid = omp_get_thread_num();
+    int tint = thread_tints[tid < 3 ? tid : 3];
+    if (gdImageTrueColor(img))
+    {
+        gray_kernels[active_isa](img->tpixels[y] + x0, out->tpixels[y] + x0, x1 - x0, tint);
+    }
+    else
     {
-        tid = omp_get_thread_num(); // Get thread ID
-        color = gdImageGetPixel(img, x, y);
-        red = gdImageRed(img, color);
-        green = gdImageGreen(img, color);
-        blue = gdImageBlue(img, color);
-        tmp = (red + green + blue) / 3; // Compute grayscale intensity
+        gray_row_palette(img->pixels[y] + x0, out->tpixels[y] + x0, x1 - x0, tint);
+    }
+}
+
+// Order in which the tile queue hands out tiles
+enum tile_order { TILE_ROW_MAJOR, TILE_MORTON, NUM_TILE_ORDERS };
+static const char *tile_order_names[NUM_TILE_ORDERS] = { "tiles-row", "tiles-z" };
 
-        // Assign unique color tint per thread
-        switch (tid)
+// Pixel rectangle [x0, x1) x [y0, y1) of one tile
+typedef struct
+{
+    int x0, y0, x1, y1;
+} tile_t;
+
+// Work done on one tile; arg is the caller's job description
+typedef void (*tile_fn)(const tile_t *tile, void *arg);
+
+// Interleaves the bits of x and y (x in the even bits): the tile's position on the Z-order curve
+static unsigned long morton_code(unsigned int x, unsigned int y)
+{
+    unsigned long code = 0;
+    for (int b = 0; b < 32; b++)
+    {
+        code |= ((unsigned long)(x >> b & 1) << (2 * b)) | ((unsigned long)(y >> b & 1) << (2 * b + 1));
+    }
+    return code;
+}
+
+static int compare_morton(const void *a, const void *b)
+{
+    const tile_t *ta = a, *tb = b;
+    unsigned long ca = morton_code(ta->x0, ta->y0), cb = morton_code(tb->x0, tb->y0);
+    return (ca > cb) - (ca < cb);
+}
+
+/**
+ * Function: run_tiles
+ * -------------------------
+ * Splits a w x h image into tile_w x tile_h tiles (smaller at the right and
+ * bottom edges) and runs fn on every tile with the current OpenMP threads.
+ *
+ * The tiles are listed in the requested order and handed out by one atomic
+ * counter: every thread takes the next tile as soon as it finishes one, so
+ * load balances like schedule(dynamic, 1) over 2D blocks. In Z-order,
+ * consecutive tiles are 2D neighbours at every scale, so tiles taken close in
+ * time also share cache lines and pages with their neighbours.
+ *
+ * Parameters:
+ *    w, h           - Image size.
+ *    tile_w, tile_h - Tile size in pixels.
+ *    order          - TILE_ROW_MAJOR or TILE_MORTON.
+ *    fn, arg        - Work per tile.
+ */
+void run_tiles(int w, int h, int tile_w, int tile_h, enum tile_order order, tile_fn fn, void *arg)
+{
+    int tiles_x = (w + tile_w - 1) / tile_w, tiles_y = (h + tile_h - 1) / tile_h;
+    int num_tiles = tiles_x * tiles_y, next = 0;
+    tile_t *tiles = malloc(num_tiles * sizeof(tile_t));
+
+    for (int ty = 0; ty < tiles_y; ty++)
+    {
+        for (int tx = 0; tx < tiles_x; tx++)
         {
-        case 0:
-            color = gdImageColorAllocate(img, tmp, 0, 0);
-            break;
-        case 1:
-            color = gdImageColorAllocate(img, 0, tmp, 0);
-            break;
-        case 2:
-            color = gdImageColorAllocate(img, 0, 0, tmp);
-            break;
-        default:
-            color = gdImageColorAllocate(img, tmp, tmp, tmp);
+            tile_t *t = &tiles[ty * tiles_x + tx];
+            t->x0 = tx * tile_w;
+            t->y0 = ty * tile_h;
+            t->x1 = t->x0 + tile_w < w ? t->x0 + tile_w : w;
+            t->y1 = t->y0 + tile_h < h ? t->y0 + tile_h : h;
         }
-        gdImageSetPixel(img, x, y, color); // Set pixel color
+    }
+    if (order == TILE_MORTON)
+    {
+        qsort(tiles, num_tiles, sizeof(tile_t), compare_morton);
+    }
+
+#pragma omp parallel
+    {
+        for (;;)
+        {
+            int i;
+#pragma omp atomic capture
+            i = next++;
+            if (i >= num_tiles)
+            {
+                break;
+            }
+            fn(&tiles[i], arg);
+        }
+    }
+
+    free(tiles);
+}
+
+// Grayscale conversion of one tile
+typedef struct
+{
+    gdImagePtr img, out;
+} gray_job_t;
+
+static void gray_tile(const tile_t *tile, void *arg)
+{
+    gray_job_t *job = arg;
+    for (int y = tile->y0; y < tile->y1; y++)
+    {
+        process_pixels(job->img, job->out, y, tile->x0, tile->x1);
     }
 }
 
+// Tile order of a tile schedule name ("tiles-row", "tiles-z"), or -1 for a row schedule
+static int tile_order(const char *schedule_type)
+{
+    for (int o = 0; o < NUM_TILE_ORDERS; o++)
+    {
+        if (strcmp(schedule_type, tile_order_names[o]) == 0)
+            return o;
+    }
+    return -1;
+}
+
+// Maps a schedule name of the sweep to the OpenMP runtime schedule kind
+static omp_sched_t schedule_kind(const char *schedule_type)
+{
+    if (strcmp(schedule_type, "dynamic") == 0)
+        return omp_sched_dynamic;
+    if (strcmp(schedule_type, "guided") == 0)
+        return omp_sched_guided;
+    return omp_sched_static;
+}
+
+/*
+ * Image I/O
+ * ---------
+ * gd decodes and encodes PNG on one thread, and at 4096x4096 that takes far
+ * longer than any of the conversions. Inputs are therefore decoded once and
+ * reused by every run. Outputs are written in one of three formats:
+ *   png  - gdImagePng (single-threaded, zlib default level)
+ *   pngz - PNG whose rows are filtered and deflated in parallel bands
+ *   ppm  - binary PPM (P6), rows packed in parallel and written with one fwrite
+ */
+
+enum output_format { OUTPUT_PNG, OUTPUT_PNGZ, OUTPUT_PPM, NUM_OUTPUT_FORMATS };
+static const char *output_format_names[NUM_OUTPUT_FORMATS] = { "png", "pngz", "ppm" };
+static const char *output_extensions[NUM_OUTPUT_FORMATS] = { "png", "png", "ppm" };
+static enum output_format output_format = OUTPUT_PNGZ;
+
+#define PNG_BAND 32         // Rows per independently deflated band of a pngz file
+#define PNG_DEFLATE_LEVEL 1 // Fast deflate: bands are compressed for throughput
+
 /**
- * Function: process_image
+ * Function: load_image
  * -------------------------
- * Reads an input PNG image, converts it to grayscale, applies a scheduling strategy,
- * and writes the output to a new PNG file. Uses OpenMP for parallel processing.
+ * Decodes a PNG file with gd.
  *
  * Parameters:
- *    iname        - Input image file name (PNG format).
- *    oname        - Output image file name (PNG format).
- *    num_threads  - Number of OpenMP threads to use.
- *    schedule_type - Type of OpenMP scheduling policy ("static", "dynamic", "guided").
- *    chunk_size   - Size of chunks for OpenMP scheduling.
+ *    iname       - Input image file name (PNG format).
+ *    decode_time - Receives the decode time (in seconds).
  *
  * Returns:
- *    Execution time (in seconds) for processing the image.
+ *    The decoded image; exits if the file is missing or not a PNG image.
  */
-double process_image(char *iname, char *oname, int num_threads, const char *schedule_type, int chunk_size)
+gdImagePtr load_image(const char *iname, double *decode_time)
 {
-    FILE *fp = NULL;
-    gdImagePtr img;
-    int x, h, w;
+    FILE *fp;
+    double start = omp_get_wtime();
 
-    // Open input image file
     if ((fp = fopen(iname, "r")) == NULL)
     {
         error(1, 0, "Error: %s not found", iname);
     }
-    img = gdImageCreateFromPng(fp);
+    gdImagePtr img = gdImageCreateFromPng(fp);
+    fclose(fp);
+    if (img == NULL)
+    {
+        error(1, 0, "Error: %s is not a valid PNG image", iname);
+    }
+
+    *decode_time = omp_get_wtime() - start;
+    return img;
+}
+
+// RGB bytes of row y of a truecolor image
+static void pack_rgb_row(gdImagePtr img, int y, unsigned char *dst)
+{
+    const int *src = img->tpixels[y];
+    for (int x = 0; x < gdImageSX(img); x++)
+    {
+        dst[3 * x] = gdTrueColorGetRed(src[x]);
+        dst[3 * x + 1] = gdTrueColorGetGreen(src[x]);
+        dst[3 * x + 2] = gdTrueColorGetBlue(src[x]);
+    }
+}
+
+static void put_be32(unsigned char *p, unsigned long v)
+{
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+}
+
+// Writes one PNG chunk: length, type, data and the CRC of type + data
+static void write_png_chunk(FILE *fp, const char *type, const unsigned char *data, size_t len)
+{
+    unsigned char head[8], crc[4];
+    put_be32(head, len);
+    memcpy(head + 4, type, 4);
+    // crc32_z with a NULL buffer returns 0 instead of the running CRC, so empty chunks (IEND) skip it
+    uLong c = crc32(0, (const Bytef *)type, 4);
+    if (len > 0)
+    {
+        c = crc32_z(c, data, len);
+    }
+    put_be32(crc, c);
+    fwrite(head, 1, 8, fp);
+    if (len > 0)
+    {
+        fwrite(data, 1, len, fp);
+    }
+    fwrite(crc, 1, 4, fp);
+}
+
+/**
+ * Writes a truecolor image as an 8-bit RGB PNG, compressed by all threads.
+ *
+ * Every band of PNG_BAND rows is Sub-filtered and deflated on its own into a
+ * raw deflate stream that ends on a byte boundary (Z_SYNC_FLUSH; the last band
+ * Z_FINISH), so the streams concatenate into one valid zlib stream. The zlib
+ * trailer is the Adler-32 of all bands joined with adler32_combine. Bands do
+ * not share a dictionary, which costs a little compression.
+ */
+static void write_png_parallel(gdImagePtr img, FILE *fp)
+{
+    int w = gdImageSX(img), h = gdImageSY(img), num_bands = (h + PNG_BAND - 1) / PNG_BAND;
+    size_t row_bytes = 1 + 3 * (size_t)w;
+    unsigned char **band_data = malloc(num_bands * sizeof(unsigned char *));
+    size_t *band_size = malloc(num_bands * sizeof(size_t));
+    uLong *band_adler = malloc(num_bands * sizeof(uLong));
+
+#pragma omp parallel for schedule(dynamic, 1)
+    for (int b = 0; b < num_bands; b++)
+    {
+        int y0 = b * PNG_BAND, rows = y0 + PNG_BAND < h ? PNG_BAND : h - y0;
+        size_t raw_size = rows * row_bytes;
+        unsigned char *raw = malloc(raw_size);
+
+        // Filter type 1 (Sub): every byte minus the same channel of the pixel to its left
+        for (int r = 0; r < rows; r++)
+        {
+            unsigned char *row = raw + r * row_bytes;
+            row[0] = 1;
+            pack_rgb_row(img, y0 + r, row + 1);
+            for (size_t i = row_bytes - 1; i > 3; i--)
+            {
+                row[i] -= row[i - 3];
+            }
+        }
+        band_adler[b] = adler32_z(1, raw, raw_size);
+
+        z_stream zs;
+        memset(&zs, 0, sizeof(zs));
+        if (deflateInit2(&zs, PNG_DEFLATE_LEVEL, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        {
+            error(1, 0, "Error: deflateInit2 failed for PNG band %d", b);
+        }
+        size_t bound = deflateBound(&zs, raw_size) + 16;
+        band_data[b] = malloc(bound);
+        zs.next_in = raw;
+        zs.avail_in = raw_size;
+        zs.next_out = band_data[b];
+        zs.avail_out = bound;
+        // The output buffer holds the whole band, so one call must consume all input and
+        // complete the flush; a full output buffer may still hold back the flush marker
+        int last = b == num_bands - 1, ret = deflate(&zs, last ? Z_FINISH : Z_SYNC_FLUSH);
+        if (ret != (last ? Z_STREAM_END : Z_OK) || zs.avail_in != 0 || zs.avail_out == 0)
+        {
+            error(1, 0, "Error: deflate failed for PNG band %d (%d, %u bytes in, %u bytes out left)", b, ret,
+                  zs.avail_in, zs.avail_out);
+        }
+        band_size[b] = bound - zs.avail_out;
+        deflateEnd(&zs);
+        free(raw);
+    }
+
+    // zlib header (deflate, 32K window, fastest), the bands, then the Adler-32 of all rows
+    size_t total = 2 + 4;
+    for (int b = 0; b < num_bands; b++)
+    {
+        total += band_size[b];
+    }
+    unsigned char *idat = malloc(total), *p = idat;
+    uLong adler = 1;
+    *p++ = 0x78;
+    *p++ = 0x01;
+    for (int b = 0; b < num_bands; b++)
+    {
+        int rows = b * PNG_BAND + PNG_BAND < h ? PNG_BAND : h - b * PNG_BAND;
+        memcpy(p, band_data[b], band_size[b]);
+        p += band_size[b];
+        adler = adler32_combine(adler, band_adler[b], rows * row_bytes);
+        free(band_data[b]);
+    }
+    put_be32(p, adler);
+
+    static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    unsigned char ihdr[13] = { 0 };
+    put_be32(ihdr, w);
+    put_be32(ihdr + 4, h);
+    ihdr[8] = 8; // Bit depth
+    ihdr[9] = 2; // Color type RGB
+    fwrite(signature, 1, 8, fp);
+    write_png_chunk(fp, "IHDR", ihdr, sizeof(ihdr));
+    write_png_chunk(fp, "IDAT", idat, total);
+    write_png_chunk(fp, "IEND", NULL, 0);
+
+    free(idat);
+    free(band_data);
+    free(band_size);
+    free(band_adler);
+}
+
+// Writes a truecolor image as a binary PPM
+static void write_ppm(gdImagePtr img, FILE *fp)
+{
+    int w = gdImageSX(img), h = gdImageSY(img);
+    unsigned char *rgb = malloc((size_t)w * h * 3);
+
+#pragma omp parallel for schedule(static)
+    for (int y = 0; y < h; y++)
+    {
+        pack_rgb_row(img, y, rgb + (size_t)y * w * 3);
+    }
+
+    fprintf(fp, "P6\n%d %d\n255\n", w, h);
+    fwrite(rgb, 1, (size_t)w * h * 3, fp);
+    free(rgb);
+}
+
+/**
+ * Decodes a written PNG with gd and exits unless it has the size and RGB
+ * pixels of img. Run once, on the first pngz output, outside the timing.
+ */
+static void check_png_roundtrip(gdImagePtr img, const char *oname)
+{
+    FILE *fp;
+    if ((fp = fopen(oname, "rb")) == NULL)
+    {
+        error(1, 0, "Error: %s not found", oname);
+    }
+    gdImagePtr back = gdImageCreateFromPng(fp);
     fclose(fp);
+    if (back == NULL)
+    {
+        error(1, 0, "Error: gd cannot decode %s written by the parallel PNG encoder", oname);
+    }
+    if (gdImageSX(back) != gdImageSX(img) || gdImageSY(back) != gdImageSY(img))
+    {
+        error(1, 0, "Error: %s decodes to %dx%d, expected %dx%d", oname, gdImageSX(back), gdImageSY(back),
+              gdImageSX(img), gdImageSY(img));
+    }
+    gdImagePaletteToTrueColor(back);
+    for (int y = 0; y < gdImageSY(img); y++)
+    {
+        for (int x = 0; x < gdImageSX(img); x++)
+        {
+            if ((back->tpixels[y][x] & 0xFFFFFF) != (img->tpixels[y][x] & 0xFFFFFF))
+            {
+                error(1, 0, "Error: %s differs from the encoded image at (%d, %d)", oname, x, y);
+            }
+        }
+    }
+    gdImageDestroy(back);
+    printf("PNG round trip: %s decodes with gd to the encoded pixels\n", oname);
+}
+
+/**
+ * Function: write_image
+ * -------------------------
+ * Writes a truecolor image in the selected output format. The first pngz
+ * output is decoded again with gd and compared (check_png_roundtrip).
+ *
+ * Returns:
+ *    Encode time (in seconds), including opening and writing the file.
+ */
+double write_image(gdImagePtr img, const char *oname)
+{
+    FILE *fp;
+    double start = omp_get_wtime();
+
+    if ((fp = fopen(oname, "wb")) == NULL)
+    {
+        error(1, 0, "Error: %s not found", oname);
+    }
+    if (output_format == OUTPUT_PNG)
+    {
+        gdImagePng(img, fp);
+    }
+    else if (output_format == OUTPUT_PNGZ)
+    {
+        write_png_parallel(img, fp);
+    }
+    else
+    {
+        write_ppm(img, fp);
+    }
+    fclose(fp);
+    double elapsed = omp_get_wtime() - start;
+
+    static int png_checked = 0;
+    if (output_format == OUTPUT_PNGZ && !png_checked)
+    {
+        check_png_roundtrip(img, oname);
+        png_checked = 1;
+    }
+
+    return elapsed;
+}
+
+/**
+ * Function: process_image
+ * -------------------------
+ * Converts a decoded image to grayscale with a scheduling strategy and writes
+ * the output image. Uses OpenMP for parallel processing.
+ *
+ * With an OpenMP schedule, rows are the work items (row-major, matching gd's
+ * row buffers); with a tile schedule, run_tiles hands out chunk_size x
+ * chunk_size tiles. The output image is allocated before the timer starts.
+ *
+ * Parameters:
+ *    img          - Decoded input image (read only, so it is reused across runs).
+ *    oname        - Output image file name, or NULL to skip writing.
+ *    num_threads  - Number of OpenMP threads to use.
+ *    schedule_type - Type of OpenMP scheduling policy ("static", "dynamic", "guided"),
+ *                    or tile order ("tiles-row", "tiles-z").
+ *    chunk_size   - Size of chunks (in rows) for OpenMP scheduling, or the tile edge in pixels.
+ *    encode_time  - Receives the time (in seconds) spent writing the output (0 if not written).
+ *
+ * Returns:
+ *    Execution time (in seconds) for processing the image.
+ */
+double process_image(gdImagePtr img, char *oname, int num_threads, const char *schedule_type, int chunk_size,
+                     double *encode_time)
+{
+    gdImagePtr out;
+    int y, h, w;
+
+    // Palette inputs are converted through a gray lookup table of their colors
+    if (!gdImageTrueColor(img))
+    {
+        fill_palette_gray(img);
+    }
 
     w = gdImageSX(img); // Get image width
     h = gdImageSY(img); // Get image height
+    out = gdImageCreateTrueColor(w, h);
 
     double start = omp_get_wtime(); // Start timing
     omp_set_num_threads(num_threads);
 
-    // Apply parallel processing with different scheduling strategies
-    if (strcmp(schedule_type, "static") == 0)
+    // Apply parallel processing with the selected scheduling strategy
+    if (tile_order(schedule_type) >= 0)
     {
-#pragma omp parallel for schedule(static, chunk_size)
-        for (x = 0; x < w; x++)
+        gray_job_t job = { img, out };
+        run_tiles(w, h, chunk_size, chunk_size, tile_order(schedule_type), gray_tile, &job);
+    }
+    else
+    {
+        omp_set_schedule(schedule_kind(schedule_type), chunk_size);
+#pragma omp parallel for schedule(runtime)
+        for (y = 0; y < h; y++)
         {
-            process_pixels(img, x, h);
+            process_pixels(img, out, y, 0, w);
         }
     }
-    else if (strcmp(schedule_type, "dynamic") == 0)
+
+    double end = omp_get_wtime(); // End timing
+
+    // Save processed image to output file
+    *encode_time = oname != NULL ? write_image(out, oname) : 0;
+    gdImageDestroy(out);
+
+    return end - start;
+}
+
+/*
+ * Edge pipeline
+ * -------------
+ * gray -> blur-x -> blur-y -> sobel -> threshold on float planes. The gray
+ * source reads the gd image with edge replication, so every later stage is
+ * a "valid" operation: a stencil stage with halo (rx, ry) turns a
+ * (w + 2 rx) x (h + 2 ry) input into a w x h output, and a point stage runs
+ * in place. Unfused, each stage streams a whole image plane through memory;
+ * fused, a tile and its halo go through all stages in two per-thread
+ * buffers that stay in cache, and only the final tile is written out.
+ */
+
+#define PIPE_BAND 16            // Rows per work item of the unfused stages
+#define PIPE_THRESHOLD 100.0f   // Sobel magnitude above which a pixel is an edge
+
+enum stage_kind { STAGE_POINT, STAGE_STENCIL };
+
+// Computes a w x h output from the input whose top-left corner is src (halo included)
+typedef void (*stage_fn)(const float *src, int src_stride, float *dst, int dst_stride, int w, int h);
+
+typedef struct
+{
+    const char *name;
+    enum stage_kind kind;
+    int rx, ry; // Halo a stencil reads on each side of an output pixel (0 for point ops)
+    stage_fn run;
+} stage_t;
+
+// Separable 5-tap Gaussian [1 4 6 4 1] / 16, horizontal pass
+static void blur_x(const float *src, int src_stride, float *dst, int dst_stride, int w, int h)
+{
+    for (int y = 0; y < h; y++)
     {
-#pragma omp parallel for schedule(dynamic, chunk_size)
-        for (x = 0; x < w; x++)
+        const float *s = src + (long)y * src_stride;
+        float *d = dst + (long)y * dst_stride;
+        for (int x = 0; x < w; x++)
         {
-            process_pixels(img, x, h);
+            d[x] = (s[x] + 4 * s[x + 1] + 6 * s[x + 2] + 4 * s[x + 3] + s[x + 4]) * (1.0f / 16);
         }
     }
-    else if (strcmp(schedule_type, "guided") == 0)
+}
+
+// Vertical pass of the same Gaussian
+static void blur_y(const float *src, int src_stride, float *dst, int dst_stride, int w, int h)
+{
+    for (int y = 0; y < h; y++)
     {
-#pragma omp parallel for schedule(guided, chunk_size)
-        for (x = 0; x < w; x++)
+        const float *s0 = src + (long)y * src_stride, *s1 = s0 + src_stride, *s2 = s1 + src_stride;
+        const float *s3 = s2 + src_stride, *s4 = s3 + src_stride;
+        float *d = dst + (long)y * dst_stride;
+        for (int x = 0; x < w; x++)
         {
-            process_pixels(img, x, h);
+            d[x] = (s0[x] + 4 * s1[x] + 6 * s2[x] + 4 * s3[x] + s4[x]) * (1.0f / 16);
         }
     }
+}
 
-    double end = omp_get_wtime(); // End timing
+// Gradient magnitude of the 3 x 3 Sobel operators
+static void sobel(const float *src, int src_stride, float *dst, int dst_stride, int w, int h)
+{
+    for (int y = 0; y < h; y++)
+    {
+        const float *r0 = src + (long)y * src_stride, *r1 = r0 + src_stride, *r2 = r1 + src_stride;
+        float *d = dst + (long)y * dst_stride;
+        for (int x = 0; x < w; x++)
+        {
+            float gx = (r0[x + 2] + 2 * r1[x + 2] + r2[x + 2]) - (r0[x] + 2 * r1[x] + r2[x]);
+            float gy = (r2[x] + 2 * r2[x + 1] + r2[x + 2]) - (r0[x] + 2 * r0[x + 1] + r0[x + 2]);
+            d[x] = sqrtf(gx * gx + gy * gy);
+        }
+    }
+}
 
-    // Save processed image to output file
-    if ((fp = fopen(oname, "w")) == NULL)
+// Edge map: 255 where the gradient is above PIPE_THRESHOLD, 0 elsewhere
+static void threshold(const float *src, int src_stride, float *dst, int dst_stride, int w, int h)
+{
+    for (int y = 0; y < h; y++)
     {
-        error(1, 0, "Error: %s not found", oname);
+        const float *s = src + (long)y * src_stride;
+        float *d = dst + (long)y * dst_stride;
+        for (int x = 0; x < w; x++)
+        {
+            d[x] = s[x] > PIPE_THRESHOLD ? 255.0f : 0.0f;
+        }
+    }
+}
+
+static const stage_t pipeline[] = {
+    { "blur-x", STAGE_STENCIL, 2, 0, blur_x },
+    { "blur-y", STAGE_STENCIL, 0, 2, blur_y },
+    { "sobel", STAGE_STENCIL, 1, 1, sobel },
+    { "threshold", STAGE_POINT, 0, 0, threshold },
+};
+static const int num_stages = sizeof(pipeline) / sizeof(pipeline[0]);
+
+// Total halo of the pipeline: how far outside an output tile the gray source must reach
+static void pipeline_halo(int *hx, int *hy)
+{
+    *hx = *hy = 0;
+    for (int s = 0; s < num_stages; s++)
+    {
+        *hx += pipeline[s].rx;
+        *hy += pipeline[s].ry;
+    }
+}
+
+// Luma of the pixel at column x of image row y
+static float pixel_luma(gdImagePtr img, int y, int x)
+{
+    if (gdImageTrueColor(img))
+    {
+        int p = img->tpixels[y][x];
+        return (float)((LUMA_R * gdTrueColorGetRed(p) + LUMA_G * gdTrueColorGetGreen(p) + LUMA_B * gdTrueColorGetBlue(p) + 128) >> 8);
+    }
+    return (float)(palette_gray[img->pixels[y][x]] & 0xFF);
+}
+
+/**
+ * Pipeline source: luma of the image rectangle at (x0, y0) of size w x h into
+ * dst. Coordinates outside the image are clamped (edge replication); only the
+ * columns left and right of the image pay for the clamp. The rectangle may lie
+ * entirely outside the image when the image is narrower than the halo.
+ */
+static void load_gray(gdImagePtr img, float *dst, int dst_stride, int x0, int y0, int w, int h)
+{
+    int iw = gdImageSX(img), ih = gdImageSY(img);
+    // Columns [0, left) lie left of the image, [w - right, w) right of it
+    int left = x0 < 0 ? -x0 : 0, right = x0 + w > iw ? x0 + w - iw : 0;
+    if (left > w)
+        left = w;
+    if (right > w - left)
+        right = w - left;
+
+    for (int y = 0; y < h; y++)
+    {
+        int sy = y0 + y < 0 ? 0 : (y0 + y >= ih ? ih - 1 : y0 + y);
+        float *d = dst + (long)y * dst_stride;
+        if (gdImageTrueColor(img))
+        {
+            const int *row = img->tpixels[sy];
+            for (int x = left; x < w - right; x++)
+            {
+                int p = row[x0 + x];
+                d[x] = (float)((LUMA_R * gdTrueColorGetRed(p) + LUMA_G * gdTrueColorGetGreen(p) + LUMA_B * gdTrueColorGetBlue(p) + 128) >> 8);
+            }
+        }
+        else
+        {
+            const unsigned char *row = img->pixels[sy];
+            for (int x = left; x < w - right; x++)
+            {
+                d[x] = (float)(palette_gray[row[x0 + x]] & 0xFF);
+            }
+        }
+
+        // Edge replication of the first and last image column
+        if (left > 0)
+        {
+            float edge = pixel_luma(img, sy, 0);
+            for (int x = 0; x < left; x++)
+            {
+                d[x] = edge;
+            }
+        }
+        if (right > 0)
+        {
+            float edge = pixel_luma(img, sy, iw - 1);
+            for (int x = w - right; x < w; x++)
+            {
+                d[x] = edge;
+            }
+        }
+    }
+}
+
+// Pipeline sink: writes a w x h float rectangle to the output at (x0, y0) and returns its edge pixels
+static long store_gray(gdImagePtr out, const float *src, int src_stride, int x0, int y0, int w, int h)
+{
+    long edges = 0;
+    for (int y = 0; y < h; y++)
+    {
+        const float *s = src + (long)y * src_stride;
+        int *d = out->tpixels[y0 + y] + x0;
+        for (int x = 0; x < w; x++)
+        {
+            int v = (int)s[x];
+            d[x] = v * 0x010101;
+            edges += v != 0;
+        }
+    }
+    return edges;
+}
+
+// Fused run: per-thread ping-pong buffers big enough for a tile plus the pipeline halo
+typedef struct
+{
+    gdImagePtr img, out;
+    float **scratch; // Two buffers per thread
+    long edges;
+} pipeline_job_t;
+
+static void pipeline_tile(const tile_t *tile, void *arg)
+{
+    pipeline_job_t *job = arg;
+    int tid = omp_get_thread_num(), hx, hy;
+    float *buf[2] = { job->scratch[2 * tid], job->scratch[2 * tid + 1] };
+    pipeline_halo(&hx, &hy);
+
+    int w = tile->x1 - tile->x0 + 2 * hx, h = tile->y1 - tile->y0 + 2 * hy, stride = w, cur = 0;
+    load_gray(job->img, buf[0], stride, tile->x0 - hx, tile->y0 - hy, w, h);
+
+    for (int s = 0; s < num_stages; s++)
+    {
+        const stage_t *st = &pipeline[s];
+        w -= 2 * st->rx;
+        h -= 2 * st->ry;
+        if (st->kind == STAGE_POINT)
+        {
+            st->run(buf[cur], stride, buf[cur], stride, w, h);
+        }
+        else
+        {
+            st->run(buf[cur], stride, buf[1 - cur], w, w, h);
+            cur = 1 - cur;
+            stride = w;
+        }
+    }
+
+    long edges = store_gray(job->out, buf[cur], stride, tile->x0, tile->y0, w, h);
+#pragma omp atomic
+    job->edges += edges;
+}
+
+// Unfused run: every stage is a parallel pass over a whole image plane
+static long pipeline_unfused(gdImagePtr img, gdImagePtr out)
+{
+    int hx, hy;
+    pipeline_halo(&hx, &hy);
+    int w = gdImageSX(img) + 2 * hx, h = gdImageSY(img) + 2 * hy, stride = w;
+    float *cur = malloc((size_t)w * h * sizeof(float));
+    long edges = 0;
+
+#pragma omp parallel for schedule(static)
+    for (int y = 0; y < h; y += PIPE_BAND)
+    {
+        load_gray(img, cur + (long)y * stride, stride, -hx, y - hy, w, y + PIPE_BAND < h ? PIPE_BAND : h - y);
+    }
+
+    for (int s = 0; s < num_stages; s++)
+    {
+        const stage_t *st = &pipeline[s];
+        int ow = w - 2 * st->rx, oh = h - 2 * st->ry;
+        float *next = st->kind == STAGE_POINT ? cur : malloc((size_t)ow * oh * sizeof(float));
+        int next_stride = st->kind == STAGE_POINT ? stride : ow;
+
+#pragma omp parallel for schedule(static)
+        for (int y = 0; y < oh; y += PIPE_BAND)
+        {
+            st->run(cur + (long)y * stride, stride, next + (long)y * next_stride, next_stride, ow,
+                    y + PIPE_BAND < oh ? PIPE_BAND : oh - y);
+        }
+
+        if (next != cur)
+        {
+            free(cur);
+        }
+        cur = next;
+        stride = next_stride;
+        w = ow;
+        h = oh;
+    }
+
+#pragma omp parallel for schedule(static) reduction(+ : edges)
+    for (int y = 0; y < h; y += PIPE_BAND)
+    {
+        edges += store_gray(out, cur + (long)y * stride, stride, 0, y, w, y + PIPE_BAND < h ? PIPE_BAND : h - y);
     }
-    gdImagePng(img, fp);
-    fclose(fp);
-    gdImageDestroy(img);
+
+    free(cur);
+    return edges;
+}
+
+/**
+ * Function: process_pipeline
+ * -------------------------
+ * Runs the edge pipeline on a decoded image and writes the edge map, like
+ * process_image.
+ *
+ * Parameters:
+ *    img         - Decoded input image.
+ *    oname       - Output image file name, or NULL to skip writing.
+ *    num_threads - Number of OpenMP threads to use.
+ *    tile_size   - Tile edge of the fused run, or 0 to run the stages unfused.
+ *    edges       - Receives the number of edge pixels (identical for every mode).
+ *    encode_time - Receives the time (in seconds) spent writing the output (0 if not written).
+ *
+ * Returns:
+ *    Execution time (in seconds) of the pipeline.
+ */
+double process_pipeline(gdImagePtr img, char *oname, int num_threads, int tile_size, long *edges, double *encode_time)
+{
+    gdImagePtr out;
+
+    if (!gdImageTrueColor(img))
+    {
+        fill_palette_gray(img);
+    }
+
+    int w = gdImageSX(img), h = gdImageSY(img), hx, hy;
+    out = gdImageCreateTrueColor(w, h);
+    pipeline_halo(&hx, &hy);
+
+    double start = omp_get_wtime();
+    omp_set_num_threads(num_threads);
+
+    if (tile_size == 0)
+    {
+        *edges = pipeline_unfused(img, out);
+    }
+    else
+    {
+        pipeline_job_t job = { img, out, malloc(2 * num_threads * sizeof(float *)), 0 };
+        for (int t = 0; t < 2 * num_threads; t++)
+        {
+            job.scratch[t] = malloc((size_t)(tile_size + 2 * hx) * (tile_size + 2 * hy) * sizeof(float));
+        }
+
+        run_tiles(w, h, tile_size, tile_size, TILE_ROW_MAJOR, pipeline_tile, &job);
+
+        for (int t = 0; t < 2 * num_threads; t++)
+        {
+            free(job.scratch[t]);
+        }
+        free(job.scratch);
+        *edges = job.edges;
+    }
+
+    double end = omp_get_wtime();
+
+    *encode_time = oname != NULL ? write_image(out, oname) : 0;
+    gdImageDestroy(out);
 
     return end - start;
 }
 
+/**
+ * Function: thread_scaling
+ * -------------------------
+ * Times the conversion of one input with 1, 2, 4, ... threads (up to the
+ * number of processors, and at least the sweep's thread count) using the
+ * static schedule, and prints the speedup over one thread.
+ *
+ * Parameters:
+ *    img         - Decoded input image.
+ *    size        - Image size, for the table.
+ *    num_threads - Thread count of the schedule sweep.
+ */
+void thread_scaling(gdImagePtr img, int size, int num_threads)
+{
+    int max_threads = omp_get_num_procs() > num_threads ? omp_get_num_procs() : num_threads;
+    double t1 = 0;
+
+    for (int t = 1; t <= max_threads; t = (t * 2 > max_threads && t < max_threads) ? max_threads : t * 2)
+    {
+        double encode_time;
+        double time = process_image(img, NULL, t, "static", 0, &encode_time);
+        if (t == 1)
+        {
+            t1 = time;
+        }
+        printf("%dx%d	%d	%.6f	%.2fx\n", size, size, t, time, t1 / time);
+    }
+}
+
 /**
  * Function: main
  * --------------
- * Runs performance tests on various image sizes, scheduling strategies, and chunk sizes.
+ * Decodes every input once, then runs performance tests on various image sizes,
+ * scheduling strategies, and chunk sizes, the thread scaling and the fused vs
+ * unfused edge pipeline of each size. Sizes without an input file are skipped.
+ *
+ * Usage: ./image_proc [png|pngz|ppm]   (output format, pngz by default)
  *
  * Returns:
  *    0 on successful execution.
  */
-int main()
+int main(int argc, char *argv[])
 {
     // Image sizes to test
     const int sizes[] = {512, 1024, 2048, 4096};
@@ -146,19 +1080,63 @@ int main()
     const char *schedules[] = {"static", "dynamic", "guided"};
     // Chunk sizes to test
     const int chunk_sizes[] = {1, 10, 50, 100};
+    // Tile orders and tile edges (pixels) to test against the row schedules
+    const char *tile_schedules[] = {"tiles-row", "tiles-z"};
+    const int tile_sizes[] = {32, 64, 128, 256};
     // Number of OpenMP threads to use
     const int num_threads = 4;
+    const int num_sizes = sizeof(sizes) / sizeof(sizes[0]);
 
-    printf("\nPerformance Results (Time in seconds)\n");
-    printf("=====================================\n");
-    printf("Size\tSchedule\tChunk\tTime\n");
+    if (argc > 1)
+    {
+        int f = 0;
+        while (f < NUM_OUTPUT_FORMATS && strcmp(argv[1], output_format_names[f]) != 0)
+            f++;
+        if (f == NUM_OUTPUT_FORMATS)
+        {
+            fprintf(stderr, "Usage: %s [png|pngz|ppm]\n", argv[0]);
+            return 1;
+        }
+        output_format = f;
+    }
+
+    detect_isa();
 
     char input_file[256], output_file[256];
+    const char *ext = output_extensions[output_format];
+    gdImagePtr inputs[sizeof(sizes) / sizeof(sizes[0])];
 
-    // Iterate over different image sizes
-    for (int i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+    // Decode every input once; all runs below reuse the decoded image
+    printf("\nDecode (gd PNG, single-threaded)\n");
+    printf("=====================================\n");
+    printf("Size\tTime\n");
+    for (int i = 0; i < num_sizes; i++)
     {
         sprintf(input_file, "input_%dx%d.png", sizes[i], sizes[i]);
+        inputs[i] = NULL;
+        if (access(input_file, R_OK) != 0)
+        {
+            printf("%dx%d\tskipped (%s not found)\n", sizes[i], sizes[i], input_file);
+            continue;
+        }
+
+        double decode_time;
+        inputs[i] = load_image(input_file, &decode_time);
+        printf("%dx%d\t%.6f\n", sizes[i], sizes[i], decode_time);
+    }
+
+    printf("\nPerformance Results (Time in seconds, %s grayscale kernel, %s output)\n", isa_names[active_isa],
+           output_format_names[output_format]);
+    printf("=====================================\n");
+    printf("Size\tSchedule\tChunk\tTime\t\tEncode\n");
+
+    // Iterate over different image sizes
+    for (int i = 0; i < num_sizes; i++)
+    {
+        if (inputs[i] == NULL)
+        {
+            continue;
+        }
 
         // Iterate over different scheduling strategies
         for (int j = 0; j < sizeof(schedules) / sizeof(schedules[0]); j++)
@@ -166,14 +1144,74 @@ int main()
             // Iterate over different chunk sizes
             for (int k = 0; k < sizeof(chunk_sizes) / sizeof(chunk_sizes[0]); k++)
             {
-                sprintf(output_file, "output/output_%dx%d_%s_%d.png", sizes[i], sizes[i], schedules[j], chunk_sizes[k]);
+                sprintf(output_file, "output/output_%dx%d_%s_%d.%s", sizes[i], sizes[i], schedules[j], chunk_sizes[k], ext);
 
-                double time = process_image(input_file, output_file, num_threads, schedules[j], chunk_sizes[k]);
+                double encode_time;
+                double time = process_image(inputs[i], output_file, num_threads, schedules[j], chunk_sizes[k], &encode_time);
 
-                printf("%dx%d\t%s\t	%d\t%.6f\n", sizes[i], sizes[i], schedules[j], chunk_sizes[k], time);
+                printf("%dx%d\t%s\t	%d\t%.6f\t%.6f\n", sizes[i], sizes[i], schedules[j], chunk_sizes[k], time, encode_time);
             }
         }
+
+        // Same image with the tile queue, for every tile order and tile size
+        for (int j = 0; j < sizeof(tile_schedules) / sizeof(tile_schedules[0]); j++)
+        {
+            for (int k = 0; k < sizeof(tile_sizes) / sizeof(tile_sizes[0]); k++)
+            {
+                sprintf(output_file, "output/output_%dx%d_%s_%d.%s", sizes[i], sizes[i], tile_schedules[j], tile_sizes[k], ext);
+
+                double encode_time;
+                double time = process_image(inputs[i], output_file, num_threads, tile_schedules[j], tile_sizes[k], &encode_time);
+
+                printf("%dx%d\t%s\t%dx%d\t%.6f\t%.6f\n", sizes[i], sizes[i], tile_schedules[j], tile_sizes[k], tile_sizes[k],
+                       time, encode_time);
+            }
+        }
+    }
+
+    printf("\nThread Scaling (static schedule, time in seconds)\n");
+    printf("=====================================\n");
+    printf("Size\tThreads\tTime\t\tSpeedup\n");
+
+    for (int i = 0; i < num_sizes; i++)
+    {
+        if (inputs[i] != NULL)
+        {
+            thread_scaling(inputs[i], sizes[i], num_threads);
+        }
+    }
+
+    // Bandwidth counts one 4-byte pixel read and one written per image pixel
+    printf("\nEdge Pipeline (gray -> blur-x -> blur-y -> sobel -> threshold, %d threads)\n", num_threads);
+    printf("=====================================\n");
+    printf("Size\tMode\tTile\tTime\t\tGB/s\tEdges\tEncode\n");
+
+    const int pipeline_tiles[] = {0, 32, 64, 128, 256};
+    for (int i = 0; i < num_sizes; i++)
+    {
+        if (inputs[i] == NULL)
+        {
+            continue;
+        }
+        long pixels = (long)gdImageSX(inputs[i]) * gdImageSY(inputs[i]);
+        for (int k = 0; k < sizeof(pipeline_tiles) / sizeof(pipeline_tiles[0]); k++)
+        {
+            long edges;
+            double encode_time;
+            sprintf(output_file, "output/edges_%dx%d_%d.%s", sizes[i], sizes[i], pipeline_tiles[k], ext);
+            double time = process_pipeline(inputs[i], output_file, num_threads, pipeline_tiles[k], &edges, &encode_time);
+            printf("%dx%d\t%s\t%d\t%.6f\t%.2f\t%ld\t%.6f\n", sizes[i], sizes[i], pipeline_tiles[k] ? "fused" : "unfused",
+                   pipeline_tiles[k], time, 8.0 * pixels / time * 1e-9, edges, encode_time);
+        }
+    }
+
+    for (int i = 0; i < num_sizes; i++)
+    {
+        if (inputs[i] != NULL)
+        {
+            gdImageDestroy(inputs[i]);
+        }
     }
 
     return 0;
-}
\ No newline at end of file
+}
@@ -45,21 +45,41 @@ int main(int argc, char *argv[])
 
     gdImagePtr outImg = gdImageCreateTrueColor(w, h);
 
-// Parallelize the image processing with OpenMP
+    // Palette inputs: the gray value of each palette entry is computed once, so the
+    // parallel loop only reads the shared input and never touches a color table
+    int paletteGray[gdMaxColors];
+    if (!gdImageTrueColor(img))
+    {
+        for (int c = 0; c < gdImageColorsTotal(img); c++)
+            paletteGray[c] = (gdImageRed(img, c) + gdImageGreen(img, c) + gdImageBlue(img, c)) / 3;
+    }
+
+// Parallelize the image processing with OpenMP (row-major, like gd's pixel rows)
 #pragma omp parallel for schedule(dynamic, 100) collapse(2)
-    for (int x = 0; x < w; x++)
+    for (int y = 0; y < h; y++)
     {
-        for (int y = 0; y < h; y++)
+        for (int x = 0; x < w; x++)
         {
-            int color = gdImageGetPixel(img, x, y);
-            int avgColor = (gdImageRed(img, color) + gdImageGreen(img, color) + gdImageBlue(img, color)) / 3;
+            int avgColor;
+            if (gdImageTrueColor(img))
+            {
+                int color = gdImageTrueColorPixel(img, x, y);
+                avgColor = (gdTrueColorGetRed(color) + gdTrueColorGetGreen(color) + gdTrueColorGetBlue(color)) / 3;
+            }
+            else
+            {
+                avgColor = paletteGray[gdImagePalettePixel(img, x, y)];
+            }
 
             // Assign a unique color for each thread
             int threadId = omp_get_thread_num();
             int threadColor = (threadId * 10) % 256;
 
-            // Set the pixel to the grayscale value (black and white) and apply the thread-specific color
-            gdImageSetPixel(outImg, x, y, gdImageColorAllocate(outImg, avgColor + threadColor, avgColor + threadColor, avgColor + threadColor));
+            // Set the pixel to the grayscale value (black and white) plus the thread-specific shade.
+            // The color is built arithmetically: gdImageColorAllocate from several threads races
+            // on the image's color table, and a full palette silently returns -1.
+            int value = avgColor + threadColor > 255 ? 255 : avgColor + threadColor;
+            gdImageTrueColorPixel(outImg, x, y) = gdTrueColor(value, value, value);
         }
     }
 
@@ -1,118 +1,2252 @@
+#define _GNU_SOURCE
+#include <immintrin.h>
+#include <linux/mempolicy.h>
 #include <omp.h>
+#include <sched.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 
-void matrix_multiply(int rows, int cols);
+// Blocking parameters for the cache-blocked GEMM kernel.
+// MC x KC block of matrix1 is sized to stay in L2, a KC x NR sliver of matrix2 in L1,
+// and the KC x NC panel of matrix2 in L3. MR x NR is the register tile of the micro-kernel;
+// a tile row is one 64-byte vector of accumulators, i.e. NR = 16 for 32-bit and 8 for 64-bit types.
+#define GEMM_MC 96
+#define GEMM_KC 256
+#define GEMM_NC 4096
+#define GEMM_MR 6
+#define GEMM_TILE_BYTES 64
 
-int main()
+// Matrix buffers are aligned to a cache line, to a page when a NUMA policy is applied,
+// and to a huge page when huge pages are requested
+#define MATRIX_ALIGN 64
+#define PAGE_SIZE 4096
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+enum matrix_layout { ROW_MAJOR, COL_MAJOR };
+
+// Element types supported by the blocked kernel.
+// Integer types accumulate in int32; int16 and int8 are multiplied in groups of 2 and 4 along k.
+enum elem_type { ELEM_I32, ELEM_I16, ELEM_I8, ELEM_F32, ELEM_F64, NUM_ELEM_TYPES };
+static const char *elem_names[NUM_ELEM_TYPES] = { "int32", "int16", "int8", "float", "double" };
+static const size_t elem_sizes[NUM_ELEM_TYPES] = { 4, 2, 1, 4, 8 };
+static const int elem_kgroup[NUM_ELEM_TYPES] = { 1, 2, 4, 1, 1 };
+static const enum elem_type elem_acc[NUM_ELEM_TYPES] = { ELEM_I32, ELEM_I32, ELEM_I32, ELEM_F32, ELEM_F64 };
+
+// Micro-kernel instruction set paths, chosen at startup by detect_isa()
+enum isa_path { ISA_GENERIC, ISA_AVX2, ISA_AVX512, ISA_AVX512_VNNI, NUM_ISAS };
+static const char *isa_names[NUM_ISAS] = { "generic", "avx2", "avx512", "avx512vnni" };
+static int isa_available[NUM_ISAS] = { 1, 0, 0, 0 };
+static enum isa_path active_isa[NUM_ELEM_TYPES];
+
+/**
+ * Dense matrix stored in one contiguous, aligned buffer.
+ * The leading dimension `ld` is the number of elements between consecutive rows
+ * (row-major) or columns (column-major); it is padded to a whole number of cache lines.
+ * Element (i, j) lives at data[i * rs + j * cs], so kernels can walk either layout.
+ */
+typedef struct
+{
+    int rows, cols;
+    int ld;
+    enum matrix_layout layout;
+    enum elem_type type;
+    size_t esz;
+    size_t rs, cs;
+    void *data;
+} matrix_t;
+
+#define MAT_AS(m, T, i, j) (((T *)(m)->data)[(size_t)(i) * (m)->rs + (size_t)(j) * (m)->cs])
+#define MAT(m, i, j) MAT_AS(m, int, i, j)
+#define MAT_PTR(m, i, j) ((const char *)(m)->data + ((size_t)(i) * (m)->rs + (size_t)(j) * (m)->cs) * (m)->esz)
+
+// Kernels that can be selected from the command line.
+// `rowptr` is the original naive kernel on an int** of separately malloc'd rows,
+// kept as the baseline for what the contiguous layout alone gains.
+enum kernel_mode { MODE_ROWPTR, MODE_NAIVE, MODE_NAIVE_COL, MODE_BLOCKED, MODE_STRASSEN, NUM_MODES };
+static const char *mode_names[NUM_MODES] = { "rowptr", "naive", "naive-col", "blocked", "strassen" };
+
+// Back matrices with transparent huge pages (--hugepages)
+static int use_huge_pages = 0;
+
+// Seed of the counter-based generator that fills the matrices (--seed=N)
+#define MATRIX_SEED 3655942
+static uint64_t matrix_seed = MATRIX_SEED;
+
+// Check every product of the thread table with Freivalds' test and compare the
+// checksums of all thread counts (--verify); the checks are not timed
+static int verify_results = 0;
+static int verify_failures = 0;
+#define FREIVALDS_TRIALS 2
+#define FREIVALDS_STREAM 0x200
+
+// Thread counts of the benchmark; the last one is the widest team
+static const int thread_counts[] = { 1, 2, 4, 8 };
+#define NUM_THREAD_COUNTS (int)(sizeof(thread_counts) / sizeof(thread_counts[0]))
+
+// Where the pages of a new matrix are placed (--placement=...):
+//   firsttouch - zeroed in parallel with the static row split the kernels use, so each
+//                thread's rows land on its own NUMA node
+//   interleave - pages spread round-robin over all nodes (MPOL_INTERLEAVE)
+//   node0      - all pages bound to node 0 (MPOL_BIND)
+//   serial     - zeroed by the master thread, i.e. everything on the master's node
+enum placement { PLACE_FIRST_TOUCH, PLACE_INTERLEAVE, PLACE_NODE0, PLACE_SERIAL, NUM_PLACEMENTS };
+static const char *placement_names[NUM_PLACEMENTS] = { "firsttouch", "interleave", "node0", "serial" };
+static enum placement matrix_placement = PLACE_FIRST_TOUCH;
+
+// Team size used for first-touch initialization (the widest team that will compute)
+static int placement_threads = 0;
+
+// Thread pinning (--bind=...): none leaves it to OMP_PROC_BIND/OMP_PLACES,
+// close pins thread t to CPU t, spread spaces the threads evenly over all CPUs
+enum binding { BIND_NONE, BIND_CLOSE, BIND_SPREAD, NUM_BINDINGS };
+
+// Strassen recursion stops below this size and calls the blocked kernel (--crossover=N)
+static int strassen_crossover = 512;
+
+// Recursion levels whose seven products run as OpenMP tasks; each level multiplies
+// the scratch space, so deeper levels run sequentially inside their task
+#define STRASSEN_TASK_LEVELS 1
+
+void matrix_multiply(int rows, int cols, int mode);
+void sparse_benchmark(int n, double density);
+static void detect_isa(void);
+static unsigned long numa_online_nodes(void);
+
+// Matrix_Multiply_MPI.c includes this file for its kernels and defines
+// MATRIX_MULTIPLY_NO_MAIN to leave out the single-node driver
+#ifndef MATRIX_MULTIPLY_NO_MAIN
+static const char *binding_names[NUM_BINDINGS] = { "none", "close", "spread" };
+
+static void isa_benchmark(int n);
+static void pin_threads(enum binding mode, int threads);
+
+int main(int argc, char *argv[])
+{
+    // Array of matrix sizes to be tested
+    int matrix_sizes[] = { 100, 400, 1600, 3200 };
+    int num_sizes = sizeof(matrix_sizes) / sizeof(matrix_sizes[0]);
+
+    // Fractions of nonzeros of the sparse comparison (--density=D picks one)
+    double densities[] = { 0.001, 0.01, 0.05, 0.2 };
+    int num_densities = sizeof(densities) / sizeof(densities[0]);
+
+    // Optional arguments: a kernel name (only that kernel is timed), `isa` (the ISA
+    // comparison), `sparse` (the sparse vs dense comparison), `all` (default: every table),
+    // --hugepages, --verify, --seed=N, --crossover=N, --density=D,
+    // --placement=firsttouch|interleave|node0|serial|all and --bind=none|close|spread
+    int first_mode = 0, last_mode = NUM_MODES - 1;
+    int first_place = PLACE_FIRST_TOUCH, last_place = PLACE_FIRST_TOUCH;
+    enum binding bind = BIND_NONE;
+    int run_threads = 1, run_isa = 1, run_sparse = 1, selected = 0;
+    for (int a = 1; a < argc; a++)
+    {
+        if (strncmp(argv[a], "--placement=", 12) == 0)
+        {
+            const char *name = argv[a] + 12;
+            if (strcmp(name, "all") == 0)
+            {
+                first_place = 0;
+                last_place = NUM_PLACEMENTS - 1;
+                continue;
+            }
+            for (first_place = 0; first_place < NUM_PLACEMENTS; first_place++)
+            {
+                if (strcmp(name, placement_names[first_place]) == 0)
+                    break;
+            }
+            if (first_place == NUM_PLACEMENTS)
+            {
+                fprintf(stderr, "Error: unknown placement %s\n", name);
+                return 1;
+            }
+            last_place = first_place;
+            continue;
+        }
+        if (strncmp(argv[a], "--bind=", 7) == 0)
+        {
+            for (bind = 0; bind < NUM_BINDINGS; bind++)
+            {
+                if (strcmp(argv[a] + 7, binding_names[bind]) == 0)
+                    break;
+            }
+            if (bind == NUM_BINDINGS)
+            {
+                fprintf(stderr, "Error: unknown binding %s\n", argv[a] + 7);
+                return 1;
+            }
+            continue;
+        }
+        if (strcmp(argv[a], "--hugepages") == 0)
+        {
+            use_huge_pages = 1;
+            continue;
+        }
+        if (strcmp(argv[a], "--verify") == 0)
+        {
+            verify_results = 1;
+            continue;
+        }
+        if (strncmp(argv[a], "--seed=", 7) == 0)
+        {
+            matrix_seed = strtoull(argv[a] + 7, NULL, 10);
+            continue;
+        }
+        if (strncmp(argv[a], "--crossover=", 12) == 0)
+        {
+            strassen_crossover = atoi(argv[a] + 12);
+            if (strassen_crossover < 1)
+            {
+                fprintf(stderr, "Error: crossover must be positive\n");
+                return 1;
+            }
+            continue;
+        }
+        if (strncmp(argv[a], "--density=", 10) == 0)
+        {
+            densities[0] = atof(argv[a] + 10);
+            num_densities = 1;
+            if (densities[0] <= 0 || densities[0] > 1)
+            {
+                fprintf(stderr, "Error: density must be in (0, 1]\n");
+                return 1;
+            }
+            continue;
+        }
+        if (strcmp(argv[a], "all") == 0)
+            continue;
+
+        // The first table named replaces the default of running every table
+        if (!selected)
+        {
+            run_threads = run_isa = run_sparse = 0;
+            selected = 1;
+        }
+        if (strcmp(argv[a], "isa") == 0)
+        {
+            run_isa = 1;
+            continue;
+        }
+        if (strcmp(argv[a], "sparse") == 0)
+        {
+            run_sparse = 1;
+            continue;
+        }
+
+        for (first_mode = 0; first_mode < NUM_MODES; first_mode++)
+        {
+            if (strcmp(argv[a], mode_names[first_mode]) == 0)
+                break;
+        }
+        if (first_mode == NUM_MODES)
+        {
+            fprintf(stderr, "Usage: %s [rowptr|naive|naive-col|blocked|strassen|isa|sparse|all] [--hugepages] [--verify] [--seed=N]"
+                            " [--crossover=N] [--density=D] [--placement=firsttouch|interleave|node0|serial|all]"
+                            " [--bind=none|close|spread]\n", argv[0]);
+            return 1;
+        }
+        last_mode = first_mode;
+        run_threads = 1;
+    }
+
+    detect_isa();
+    printf("\nMicro-kernels: int32=%s int16=%s int8=%s float=%s double=%s\n",
+           isa_names[active_isa[ELEM_I32]], isa_names[active_isa[ELEM_I16]], isa_names[active_isa[ELEM_I8]],
+           isa_names[active_isa[ELEM_F32]], isa_names[active_isa[ELEM_F64]]);
+
+    // Pages are placed for, and threads pinned as, the widest team of the sweep
+    placement_threads = thread_counts[NUM_THREAD_COUNTS - 1];
+    pin_threads(bind, placement_threads);
+    const char *proc_bind = getenv("OMP_PROC_BIND"), *places = getenv("OMP_PLACES");
+    printf("Thread binding: %s (OMP_PROC_BIND=%s, OMP_PLACES=%s), NUMA nodes online: 0x%lx\n",
+           binding_names[bind], proc_bind ? proc_bind : "unset", places ? places : "unset", numa_online_nodes());
+
+    if (run_threads)
+    {
+        // Print table header; --verify adds a column with the checksum every thread count produced
+        const char *rule = verify_results
+            ? "+------------+------------+------------+------------+------------+------------+------------+--------------------+\n"
+            : "+------------+------------+------------+------------+------------+------------+------------+\n";
+        printf("\n");
+        printf("%s", rule);
+        printf("| %10s | %10s | %10s | %10s | %10s | %10s | %10s |", "Kernel", "Placement", "MatrixSize", "1 Thread", "2 Thread", "4 Thread", "8 Thread" );
+        printf(verify_results ? " %18s |\n" : "\n", "Checksum");
+        printf("%s", rule);
+
+        // Iterate over different matrix sizes, timing every selected kernel and placement for each size
+        for (int i = 0; i < num_sizes; i++)
+        {
+            for (int mode = first_mode; mode <= last_mode; mode++)
+            {
+                for (int place = first_place; place <= last_place; place++)
+                {
+                    matrix_placement = place;
+                    matrix_multiply(matrix_sizes[i], matrix_sizes[i], mode);
+                }
+            }
+        }
+
+        printf("%s", rule);
+        matrix_placement = first_place;
+    }
+
+    if (run_isa)
+    {
+        // Blocked kernel per element type and instruction set, with all threads
+        printf("\nBlocked kernel by ISA path (%d threads)\n", omp_get_max_threads());
+        printf("+------------+------------+------------+------------+------------+------------+\n");
+        printf("| %10s | %10s | %10s | %10s | %10s | %10s |\n", "Type", "MatrixSize",
+               isa_names[ISA_GENERIC], isa_names[ISA_AVX2], isa_names[ISA_AVX512], isa_names[ISA_AVX512_VNNI]);
+        printf("+------------+------------+------------+------------+------------+------------+\n");
+
+        for (int i = 0; i < num_sizes; i++)
+        {
+            isa_benchmark(matrix_sizes[i]);
+        }
+
+        printf("+------------+------------+------------+------------+------------+------------+\n");
+    }
+
+    if (run_sparse)
+    {
+        // Sparse kernels against their dense counterparts on the same inputs, with all threads;
+        // the matrix-vector columns are the time of one product
+        printf("\nSparse vs dense (%d threads, nonzeros in [1, 100])\n", omp_get_max_threads());
+        // --verify adds a column with the result of checking every product
+        const char *rule = verify_results
+            ? "+------------+------------+------------+------------+------------+------------+------------+------------+------------+\n"
+            : "+------------+------------+------------+------------+------------+------------+------------+------------+\n";
+        printf("%s", rule);
+        printf("| %10s | %10s | %10s | %10s | %10s | %10s | %10s | %10s |", "Density", "MatrixSize", "NNZ/Row",
+               "blocked", "SpGEMM", "dense MV", "SpMV csr", "SpMV csc");
+        printf(verify_results ? " %10s |\n" : "\n", "Check");
+        printf("%s", rule);
+
+        for (int i = 0; i < num_sizes; i++)
+        {
+            for (int d = 0; d < num_densities; d++)
+            {
+                sparse_benchmark(matrix_sizes[i], densities[d]);
+            }
+        }
+
+        printf("%s", rule);
+    }
+
+    return verify_failures > 0;
+}
+#endif
+
+// Bit mask of the online NUMA nodes, from sysfs (e.g. "0-1" -> 0x3)
+static unsigned long numa_online_nodes(void)
+{
+    unsigned long mask = 0;
+    FILE *fp = fopen("/sys/devices/system/node/online", "r");
+    if (fp)
+    {
+        int lo, hi;
+        char sep;
+        while (fscanf(fp, "%d", &lo) == 1)
+        {
+            hi = lo;
+            if (fscanf(fp, "%c", &sep) == 1 && sep == '-')
+            {
+                if (fscanf(fp, "%d", &hi) != 1)
+                    break;
+                if (fscanf(fp, "%c", &sep) != 1)
+                    sep = '\n';
+            }
+            for (int node = lo; node <= hi && node < 64; node++)
+                mask |= 1UL << node;
+            if (sep != ',')
+                break;
+        }
+        fclose(fp);
+    }
+    return mask ? mask : 1;
+}
+
+/**
+ * Zeroes a freshly allocated matrix buffer according to matrix_placement.
+ * For the mbind() policies the buffer is page aligned; a failing mbind() (no NUMA
+ * support, restricted container) is reported once and the pages fall back to first touch.
+ *
+ * @param data, bytes: The buffer.
+ * @param outer, stride: Number of rows (columns for column-major) and bytes between them.
+ */
+static void matrix_place(void *data, size_t bytes, int outer, size_t stride)
+{
+    static int warned = 0;
+
+    if (matrix_placement == PLACE_INTERLEAVE || matrix_placement == PLACE_NODE0)
+    {
+        unsigned long mask = (matrix_placement == PLACE_NODE0) ? 1UL : numa_online_nodes();
+        int policy = (matrix_placement == PLACE_NODE0) ? MPOL_BIND : MPOL_INTERLEAVE;
+        size_t len = (bytes + PAGE_SIZE - 1) / PAGE_SIZE * PAGE_SIZE;
+        if (syscall(SYS_mbind, data, len, policy, &mask, sizeof(mask) * 8, 0) != 0 && !warned)
+        {
+            perror("Warning: mbind");
+            warned = 1;
+        }
+    }
+
+    if (matrix_placement != PLACE_FIRST_TOUCH)
+    {
+        memset(data, 0, bytes);
+        return;
+    }
+
+    // Same split as the blocked kernel's row loop: GEMM_MC-row blocks, schedule(static),
+    // over the widest team of the sweep. Runs with that team update the rows they touched
+    // here; narrower teams of the same sweep reuse the matrices and cannot all match.
+    int threads = placement_threads > 0 ? placement_threads : omp_get_max_threads();
+    #pragma omp parallel for schedule(static) num_threads(threads)
+    for (int i0 = 0; i0 < outer; i0 += GEMM_MC)
+    {
+        int rows = (outer - i0 < GEMM_MC) ? outer - i0 : GEMM_MC;
+        memset((char *)data + i0 * stride, 0, rows * stride);
+    }
+    memset((char *)data + outer * stride, 0, bytes - outer * stride);
+}
+
+/**
+ * Allocates a zeroed rows x cols matrix of the given element type in a single aligned buffer.
+ * The leading dimension is rounded up to a whole number of cache lines; if that lands
+ * on a multiple of 4 KB, one extra cache line is added so that consecutive rows do not
+ * map to the same cache sets.
+ *
+ * @param rows, cols: Matrix dimensions.
+ * @param type: Element type.
+ * @param layout: ROW_MAJOR or COL_MAJOR.
+ * @param huge_pages: Non-zero to request transparent huge pages with madvise().
+ */
+static matrix_t matrix_create_typed(int rows, int cols, enum elem_type type, enum matrix_layout layout, int huge_pages)
+{
+    matrix_t m;
+    int line = MATRIX_ALIGN / elem_sizes[type];
+    int inner = (layout == ROW_MAJOR) ? cols : rows;
+    int outer = (layout == ROW_MAJOR) ? rows : cols;
+
+    m.rows = rows;
+    m.cols = cols;
+    m.layout = layout;
+    m.type = type;
+    m.esz = elem_sizes[type];
+    m.ld = (inner + line - 1) / line * line;
+    if (m.ld * m.esz % 4096 == 0)
+        m.ld += line;
+    m.rs = (layout == ROW_MAJOR) ? (size_t)m.ld : 1;
+    m.cs = (layout == ROW_MAJOR) ? 1 : (size_t)m.ld;
+
+    size_t align = huge_pages ? HUGE_PAGE_SIZE : MATRIX_ALIGN;
+    if (!huge_pages && (matrix_placement == PLACE_INTERLEAVE || matrix_placement == PLACE_NODE0))
+        align = PAGE_SIZE;  // mbind() works on whole pages
+    size_t bytes = (size_t)outer * m.ld * m.esz;
+    bytes = (bytes + align - 1) / align * align;
+
+    if (posix_memalign(&m.data, align, bytes) != 0)
+    {
+        fprintf(stderr, "Error: cannot allocate %dx%d matrix\n", rows, cols);
+        exit(1);
+    }
+    if (huge_pages)
+        madvise(m.data, bytes, MADV_HUGEPAGE);  // Advisory only; falls back to 4 KB pages
+
+    // Zeroing is the first touch, so it decides which NUMA node backs each page
+    matrix_place(m.data, bytes, outer, (size_t)m.ld * m.esz);
+    return m;
+}
+
+// int32 matrix, the type used by the thread-count benchmark
+static matrix_t matrix_create(int rows, int cols, enum matrix_layout layout, int huge_pages)
+{
+    return matrix_create_typed(rows, cols, ELEM_I32, layout, huge_pages);
+}
+
+static void matrix_free(matrix_t *m)
+{
+    free(m->data);
+    m->data = NULL;
+}
+
+/**
+ * Counter-based random bits for element (i, j) of stream `stream`.
+ * This is SplitMix64's output for the counter (i, j): it depends only on
+ * (seed, stream, i, j), so any thread can generate any element in any order and
+ * the matrices are bit-identical for every thread count. There is no shared
+ * state, unlike rand(), whose hidden state and lock serialize a parallel loop.
+ */
+static inline uint64_t random_bits(uint64_t seed, uint64_t stream, uint32_t i, uint32_t j)
+{
+    uint64_t z = seed ^ (stream * 0xD1B54A32D192ED03ULL);
+    z += (((uint64_t)i << 32) | j) * 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Counter-based random value in [0, 100) for element (i, j) of stream `stream`
+static inline int random_value(uint64_t seed, uint64_t stream, uint32_t i, uint32_t j)
+{
+    return (int)(((random_bits(seed, stream, i, j) >> 32) * 100) >> 32);  // Multiply-shift instead of a modulo
+}
+
+#define FILL_RANDOM(T)                                                              \
+    _Pragma("omp parallel for schedule(static) num_threads(threads)")               \
+    for (int i = 0; i < m->rows; i++)                                               \
+    {                                                                               \
+        _Pragma("omp simd")                                                         \
+        for (int j = 0; j < m->cols; j++)                                           \
+            MAT_AS(m, T, i, j) = (T)random_value(matrix_seed, stream, i, j);        \
+    }
+
+/**
+ * Fills a matrix of any element type with random_value(matrix_seed, stream, i, j),
+ * splitting rows statically over the widest team.
+ */
+static void matrix_fill_random(matrix_t *m, uint64_t stream)
+{
+    int threads = placement_threads > 0 ? placement_threads : omp_get_max_threads();
+    switch (m->type)
+    {
+    case ELEM_I32: FILL_RANDOM(int32_t); break;
+    case ELEM_I16: FILL_RANDOM(int16_t); break;
+    case ELEM_I8:  FILL_RANDOM(int8_t);  break;
+    case ELEM_F32: FILL_RANDOM(float);   break;
+    case ELEM_F64: FILL_RANDOM(double);  break;
+    default: break;
+    }
+}
+
+// Stream offset of the pattern that decides which elements of a sparse input are nonzero
+#define SPARSE_PATTERN_STREAM 0x100
+
+/**
+ * Fills an int32 matrix so that each element is nonzero with probability `density`.
+ * The pattern and the values come from the counter-based generator, so the same
+ * (seed, stream, density) gives the same matrix in dense and in compressed form.
+ * Nonzero values lie in [1, 100].
+ */
+static void matrix_fill_sparse(matrix_t *m, uint64_t stream, double density)
+{
+    int threads = placement_threads > 0 ? placement_threads : omp_get_max_threads();
+    uint64_t threshold = density >= 1.0 ? UINT64_MAX : (uint64_t)(density * 18446744073709551616.0);
+
+    #pragma omp parallel for schedule(static) num_threads(threads)
+    for (int i = 0; i < m->rows; i++)
+    {
+        for (int j = 0; j < m->cols; j++)
+        {
+            int keep = random_bits(matrix_seed, stream + SPARSE_PATTERN_STREAM, i, j) < threshold;
+            MAT(m, i, j) = keep ? random_value(matrix_seed, stream, i, j) + 1 : 0;
+        }
+    }
+}
+
+/**
+ * Order-independent checksum of an int32 matrix: the sum of every element weighted
+ * by its position. Equal matrices give equal checksums for any thread count.
+ */
+static uint64_t matrix_checksum(const matrix_t *m)
+{
+    uint64_t sum = 0;
+    #pragma omp parallel for schedule(static) reduction(+ : sum)
+    for (int i = 0; i < m->rows; i++)
+    {
+        for (int j = 0; j < m->cols; j++)
+        {
+            sum += (uint64_t)(uint32_t)MAT(m, i, j) * ((uint64_t)i * m->cols + j + 1);
+        }
+    }
+    return sum;
+}
+
+// Checksums (matrix_checksum) of matrix1 and matrix2 as generated with MATRIX_SEED
+static const struct
+{
+    int n;
+    uint64_t matrix1, matrix2;
+} init_checksums[] = {
+    { 100, 0x00000000935d0457ULL, 0x000000009303b76cULL },
+    { 400, 0x00000093c0206056ULL, 0x0000009333ac007bULL },
+    { 1600, 0x0000937a8a959f7cULL, 0x00009394df769b75ULL },
+    { 3200, 0x0009384c85d91678ULL, 0x000937c6af7bee0dULL },
+};
+
+/**
+ * Compares freshly generated inputs against the stored checksums, so a change to the
+ * generator or to the parallel initialization is caught before anything is timed.
+ * Only sizes in the table and the default seed can be checked.
+ */
+static void check_init_checksums(const matrix_t *matrix1, const matrix_t *matrix2)
+{
+    if (matrix_seed != MATRIX_SEED)
+        return;
+
+    for (size_t k = 0; k < sizeof(init_checksums) / sizeof(init_checksums[0]); k++)
+    {
+        if (init_checksums[k].n != matrix1->rows)
+            continue;
+        if (matrix_checksum(matrix1) != init_checksums[k].matrix1 || matrix_checksum(matrix2) != init_checksums[k].matrix2)
+        {
+            fprintf(stderr, "Error: %dx%d input matrices do not match the stored checksum\n",
+                    matrix1->rows, matrix1->cols);
+            exit(1);
+        }
+    }
+}
+
+/**
+ * Freivalds' test of result == matrix1 * matrix2 in O(n^2) per trial instead of the
+ * O(n^3) of a reference multiply: for a random vector r, matrix1 (matrix2 r) must equal
+ * result r. Arithmetic is modulo 2^64 with r drawn from the counter-based generator,
+ * so a wrong row passes a trial only if r is orthogonal to its error modulo 2^64.
+ *
+ * Returns the number of mismatching rows over all trials (0 if the result is correct).
+ */
+static long freivalds_check(const matrix_t *matrix1, const matrix_t *matrix2, const matrix_t *result, int trials)
+{
+    uint64_t *r = malloc(matrix2->cols * sizeof(uint64_t));
+    uint64_t *br = malloc(matrix2->rows * sizeof(uint64_t));
+    long bad = 0;
+
+    for (int trial = 0; trial < trials; trial++)
+    {
+        for (int j = 0; j < matrix2->cols; j++)
+            r[j] = random_bits(matrix_seed, FREIVALDS_STREAM, trial, j);
+
+        #pragma omp parallel for schedule(static)
+        for (int k = 0; k < matrix2->rows; k++)
+        {
+            uint64_t sum = 0;
+            for (int j = 0; j < matrix2->cols; j++)
+                sum += (uint64_t)(int64_t)MAT(matrix2, k, j) * r[j];
+            br[k] = sum;
+        }
+
+        #pragma omp parallel for schedule(static) reduction(+ : bad)
+        for (int i = 0; i < matrix1->rows; i++)
+        {
+            uint64_t abr = 0, cr = 0;
+            for (int k = 0; k < matrix1->cols; k++)
+                abr += (uint64_t)(int64_t)MAT(matrix1, i, k) * br[k];
+            for (int j = 0; j < result->cols; j++)
+                cr += (uint64_t)(int64_t)MAT(result, i, j) * r[j];
+            bad += abr != cr;
+        }
+    }
+
+    free(r);
+    free(br);
+    return bad;
+}
+
+/**
+ * Original naive kernel on an int** of separately allocated rows.
+ * Only used as the baseline for the `rowptr` mode.
+ */
+static void multiply_rowptr(int n, int **matrix1, int **matrix2, int **result)
+{
+    int i, j, k;
+
+    #pragma omp parallel for collapse(2) schedule(static)
+    for (i = 0; i < n; i++)
+    {
+        for (j = 0; j < n; j++)
+        {
+            int sum = 0;
+
+            #pragma omp simd reduction(+:sum)
+            for (k = 0; k < n; k++)
+            {
+                sum += matrix1[i][k] * matrix2[k][j];
+            }
+
+            result[i][j] = sum;
+        }
+    }
+}
+
+/**
+ * Naive matrix multiplication: every result element is a dot product of a row of
+ * matrix1 with a column of matrix2. Works with any layout of the inputs; when
+ * matrix2 is column-major its columns are contiguous and the dot product is unit-stride.
+ *
+ * @param n: Dimension of the square matrices.
+ * @param matrix1, matrix2: Input matrices.
+ * @param result: Output matrix.
+ */
+static void multiply_naive(int n, const matrix_t *matrix1, const matrix_t *matrix2, matrix_t *result)
+{
+    int i, j, k;
+    size_t a_cs = matrix1->cs, b_rs = matrix2->rs;
+
+    // Parallelizing the outer loops using OpenMP
+    // `collapse(2)` ensures that both row and column loops are parallelized together
+    // `schedule(static)` ensures uniform workload distribution among threads
+    #pragma omp parallel for collapse(2) schedule(static)
+    for (i = 0; i < n; i++)
+    {
+        for (j = 0; j < n; j++)
+        {
+            const int *a = &MAT(matrix1, i, 0);
+            const int *b = &MAT(matrix2, 0, j);
+            int sum = 0;
+
+            // The innermost loop performs the multiplication and summation
+            // Using `#pragma omp simd reduction(+:sum)` enables SIMD vectorization
+            // `reduction(+:sum)` ensures that different threads sum correctly
+            #pragma omp simd reduction(+:sum)
+            for (k = 0; k < n; k++)
+            {
+                sum += a[k * a_cs] * b[k * b_rs];
+            }
+
+            MAT(result, i, j) = sum;  // Store the computed value in the result matrix
+        }
+    }
+}
+
+/**
+ * Copies one element of `esz` bytes, or writes a zero when `src` is NULL.
+ * Packing routines are shared by every element type, so they move raw elements.
+ */
+static inline char *copy_elem(char *dst, const char *src, size_t esz)
+{
+    switch (esz)
+    {
+    case 1: *(int8_t *)dst = src ? *(const int8_t *)src : 0; break;
+    case 2: *(int16_t *)dst = src ? *(const int16_t *)src : 0; break;
+    case 4: *(int32_t *)dst = src ? *(const int32_t *)src : 0; break;
+    default: *(int64_t *)dst = src ? *(const int64_t *)src : 0; break;
+    }
+    return dst + esz;
+}
+
+/**
+ * Packs an mc x kc block of matrix1 into row slivers of height GEMM_MR.
+ * k is walked in groups of `kg` (1 for 32/64-bit types, 2 for int16, 4 for int8):
+ * for every group the packed sliver holds GEMM_MR rows of kg consecutive values,
+ * which is the operand a dot-product instruction (pmaddwd, vpdpbusd) broadcasts.
+ * Rows and columns past the edge of the matrix are padded with zeros.
+ */
+static void pack_a(const matrix_t *a, int ic, int pc, int mc, int kc, int kg, char *buf)
+{
+    for (int ir = 0; ir < mc; ir += GEMM_MR)
+    {
+        for (int p = 0; p < kc; p += kg)
+        {
+            for (int r = 0; r < GEMM_MR; r++)
+            {
+                for (int q = 0; q < kg; q++)
+                {
+                    int inside = (ir + r < mc) && (p + q < kc);
+                    buf = copy_elem(buf, inside ? MAT_PTR(a, ic + ir + r, pc + p + q) : NULL, a->esz);
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Packs one kc x nr sliver of matrix2 starting at (pc, jc), in the same k-groups as pack_a:
+ * for every group, `nr` columns of kg consecutive values.
+ * Columns past the edge of the matrix are padded with zeros.
+ */
+static void pack_b_sliver(const matrix_t *b, int pc, int jc, int kc, int nr_valid, int nr, int kg, char *buf)
+{
+    for (int p = 0; p < kc; p += kg)
+    {
+        for (int j = 0; j < nr; j++)
+        {
+            for (int q = 0; q < kg; q++)
+            {
+                int inside = (j < nr_valid) && (p + q < kc);
+                buf = copy_elem(buf, inside ? MAT_PTR(b, pc + p + q, jc + j) : NULL, b->esz);
+            }
+        }
+    }
+}
+
+/*
+ * Register-blocked micro-kernels.
+ * Each computes a GEMM_MR x NR tile as a sum of outer products of packed A and B
+ * slivers and stores it to `acc` (int32 for integer inputs, otherwise the input type).
+ * `groups` is the number of k-groups in the packed slivers.
+ */
+typedef void (*micro_kernel_fn)(int groups, const void *a, const void *b, void *acc);
+
+// Portable C fallback, shared by all element types
+#define GENERIC_KERNEL(name, T, ACC, NR, KG)                                          \
+    static void name(int groups, const void *pa, const void *pb, void *pacc)          \
+    {                                                                                 \
+        const T *a = pa, *b = pb;                                                     \
+        ACC acc[GEMM_MR][NR] = { { 0 } };                                             \
+        for (int g = 0; g < groups; g++)                                              \
+            for (int r = 0; r < GEMM_MR; r++)                                         \
+                for (int q = 0; q < KG; q++)                                          \
+                {                                                                     \
+                    ACC av = a[(g * GEMM_MR + r) * KG + q];                           \
+                    _Pragma("omp simd")                                               \
+                    for (int j = 0; j < NR; j++)                                      \
+                        acc[r][j] += av * (ACC)b[(g * NR + j) * KG + q];              \
+                }                                                                     \
+        memcpy(pacc, acc, sizeof(acc));                                               \
+    }
+
+GENERIC_KERNEL(kernel_i32_generic, int32_t, int32_t, 16, 1)
+GENERIC_KERNEL(kernel_i16_generic, int16_t, int32_t, 16, 2)
+GENERIC_KERNEL(kernel_i8_generic, int8_t, int32_t, 16, 4)
+GENERIC_KERNEL(kernel_f32_generic, float, float, 16, 1)
+GENERIC_KERNEL(kernel_f64_generic, double, double, 8, 1)
+
+/*
+ * AVX2 kernels: a 6 x 16 tile is 12 ymm accumulators (6 x 8 for double),
+ * leaving registers for two B vectors and one broadcast A value.
+ */
+__attribute__((target("avx2,fma")))
+static void kernel_i32_avx2(int groups, const void *pa, const void *pb, void *pacc)
+{
+    const int32_t *a = pa, *b = pb;
+    __m256i c[GEMM_MR][2];
+    for (int r = 0; r < GEMM_MR; r++)
+        c[r][0] = c[r][1] = _mm256_setzero_si256();
+
+    for (int g = 0; g < groups; g++)
+    {
+        __m256i b0 = _mm256_loadu_si256((const __m256i *)&b[g * 16]);
+        __m256i b1 = _mm256_loadu_si256((const __m256i *)&b[g * 16 + 8]);
+        for (int r = 0; r < GEMM_MR; r++)
+        {
+            __m256i av = _mm256_set1_epi32(a[g * GEMM_MR + r]);
+            c[r][0] = _mm256_add_epi32(c[r][0], _mm256_mullo_epi32(av, b0));
+            c[r][1] = _mm256_add_epi32(c[r][1], _mm256_mullo_epi32(av, b1));
+        }
+    }
+
+    for (int r = 0; r < GEMM_MR; r++)
+    {
+        _mm256_storeu_si256((__m256i *)pacc + 2 * r, c[r][0]);
+        _mm256_storeu_si256((__m256i *)pacc + 2 * r + 1, c[r][1]);
+    }
+}
+
+// int16: pmaddwd multiplies pairs along k and adds them into int32 lanes
+__attribute__((target("avx2,fma")))
+static void kernel_i16_avx2(int groups, const void *pa, const void *pb, void *pacc)
+{
+    const int16_t *a = pa, *b = pb;
+    __m256i c[GEMM_MR][2];
+    for (int r = 0; r < GEMM_MR; r++)
+        c[r][0] = c[r][1] = _mm256_setzero_si256();
+
+    for (int g = 0; g < groups; g++)
+    {
+        __m256i b0 = _mm256_loadu_si256((const __m256i *)&b[g * 32]);
+        __m256i b1 = _mm256_loadu_si256((const __m256i *)&b[g * 32 + 16]);
+        for (int r = 0; r < GEMM_MR; r++)
+        {
+            int32_t pair;
+            memcpy(&pair, &a[(g * GEMM_MR + r) * 2], sizeof(pair));
+            __m256i av = _mm256_set1_epi32(pair);
+            c[r][0] = _mm256_add_epi32(c[r][0], _mm256_madd_epi16(av, b0));
+            c[r][1] = _mm256_add_epi32(c[r][1], _mm256_madd_epi16(av, b1));
+        }
+    }
+
+    for (int r = 0; r < GEMM_MR; r++)
+    {
+        _mm256_storeu_si256((__m256i *)pacc + 2 * r, c[r][0]);
+        _mm256_storeu_si256((__m256i *)pacc + 2 * r + 1, c[r][1]);
+    }
+}
+
+// int8: pmaddubsw (u8 x s8 -> pairs of int16), then pmaddwd with ones folds to int32.
+// matrix1 values must be in [0, 127] so that the unsigned operand and the int16 pair sum are exact.
+__attribute__((target("avx2,fma")))
+static void kernel_i8_avx2(int groups, const void *pa, const void *pb, void *pacc)
+{
+    const int8_t *a = pa, *b = pb;
+    const __m256i ones = _mm256_set1_epi16(1);
+    __m256i c[GEMM_MR][2];
+    for (int r = 0; r < GEMM_MR; r++)
+        c[r][0] = c[r][1] = _mm256_setzero_si256();
+
+    for (int g = 0; g < groups; g++)
+    {
+        __m256i b0 = _mm256_loadu_si256((const __m256i *)&b[g * 64]);
+        __m256i b1 = _mm256_loadu_si256((const __m256i *)&b[g * 64 + 32]);
+        for (int r = 0; r < GEMM_MR; r++)
+        {
+            int32_t quad;
+            memcpy(&quad, &a[(g * GEMM_MR + r) * 4], sizeof(quad));
+            __m256i av = _mm256_set1_epi32(quad);
+            c[r][0] = _mm256_add_epi32(c[r][0], _mm256_madd_epi16(_mm256_maddubs_epi16(av, b0), ones));
+            c[r][1] = _mm256_add_epi32(c[r][1], _mm256_madd_epi16(_mm256_maddubs_epi16(av, b1), ones));
+        }
+    }
+
+    for (int r = 0; r < GEMM_MR; r++)
+    {
+        _mm256_storeu_si256((__m256i *)pacc + 2 * r, c[r][0]);
+        _mm256_storeu_si256((__m256i *)pacc + 2 * r + 1, c[r][1]);
+    }
+}
+
+__attribute__((target("avx2,fma")))
+static void kernel_f32_avx2(int groups, const void *pa, const void *pb, void *pacc)
+{
+    const float *a = pa, *b = pb;
+    __m256 c[GEMM_MR][2];
+    for (int r = 0; r < GEMM_MR; r++)
+        c[r][0] = c[r][1] = _mm256_setzero_ps();
+
+    for (int g = 0; g < groups; g++)
+    {
+        __m256 b0 = _mm256_loadu_ps(&b[g * 16]);
+        __m256 b1 = _mm256_loadu_ps(&b[g * 16 + 8]);
+        for (int r = 0; r < GEMM_MR; r++)
+        {
+            __m256 av = _mm256_broadcast_ss(&a[g * GEMM_MR + r]);
+            c[r][0] = _mm256_fmadd_ps(av, b0, c[r][0]);
+            c[r][1] = _mm256_fmadd_ps(av, b1, c[r][1]);
+        }
+    }
+
+    for (int r = 0; r < GEMM_MR; r++)
+    {
+        _mm256_storeu_ps((float *)pacc + 16 * r, c[r][0]);
+        _mm256_storeu_ps((float *)pacc + 16 * r + 8, c[r][1]);
+    }
+}
+
+__attribute__((target("avx2,fma")))
+static void kernel_f64_avx2(int groups, const void *pa, const void *pb, void *pacc)
+{
+    const double *a = pa, *b = pb;
+    __m256d c[GEMM_MR][2];
+    for (int r = 0; r < GEMM_MR; r++)
+        c[r][0] = c[r][1] = _mm256_setzero_pd();
+
+    for (int g = 0; g < groups; g++)
+    {
+        __m256d b0 = _mm256_loadu_pd(&b[g * 8]);
+        __m256d b1 = _mm256_loadu_pd(&b[g * 8 + 4]);
+        for (int r = 0; r < GEMM_MR; r++)
+        {
+            __m256d av = _mm256_broadcast_sd(&a[g * GEMM_MR + r]);
+            c[r][0] = _mm256_fmadd_pd(av, b0, c[r][0]);
+            c[r][1] = _mm256_fmadd_pd(av, b1, c[r][1]);
+        }
+    }
+
+    for (int r = 0; r < GEMM_MR; r++)
+    {
+        _mm256_storeu_pd((double *)pacc + 8 * r, c[r][0]);
+        _mm256_storeu_pd((double *)pacc + 8 * r + 4, c[r][1]);
+    }
+}
+
+/*
+ * AVX-512 kernels: one zmm holds a full row of the tile, so GEMM_MR accumulators.
+ * The VNNI variants fuse the int16/int8 multiply and the int32 accumulation
+ * into a single vpdpwssd / vpdpbusd.
+ */
+#define AVX512_KERNEL_BEGIN(T)                                  \
+    const T *a = pa, *b = pb;                                   \
+    __m512i c[GEMM_MR];                                         \
+    for (int r = 0; r < GEMM_MR; r++)                           \
+        c[r] = _mm512_setzero_si512();
+
+#define AVX512_KERNEL_END                                       \
+    for (int r = 0; r < GEMM_MR; r++)                           \
+        _mm512_storeu_si512((__m512i *)pacc + r, c[r]);
+
+__attribute__((target("avx512f,avx512bw")))
+static void kernel_i32_avx512(int groups, const void *pa, const void *pb, void *pacc)
+{
+    AVX512_KERNEL_BEGIN(int32_t)
+    for (int g = 0; g < groups; g++)
+    {
+        __m512i b0 = _mm512_loadu_si512(&b[g * 16]);
+        for (int r = 0; r < GEMM_MR; r++)
+            c[r] = _mm512_add_epi32(c[r], _mm512_mullo_epi32(_mm512_set1_epi32(a[g * GEMM_MR + r]), b0));
+    }
+    AVX512_KERNEL_END
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static void kernel_i16_avx512(int groups, const void *pa, const void *pb, void *pacc)
+{
+    AVX512_KERNEL_BEGIN(int16_t)
+    for (int g = 0; g < groups; g++)
+    {
+        __m512i b0 = _mm512_loadu_si512(&b[g * 32]);
+        for (int r = 0; r < GEMM_MR; r++)
+        {
+            int32_t pair;
+            memcpy(&pair, &a[(g * GEMM_MR + r) * 2], sizeof(pair));
+            c[r] = _mm512_add_epi32(c[r], _mm512_madd_epi16(_mm512_set1_epi32(pair), b0));
+        }
+    }
+    AVX512_KERNEL_END
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static void kernel_i8_avx512(int groups, const void *pa, const void *pb, void *pacc)
+{
+    const __m512i ones = _mm512_set1_epi16(1);
+    AVX512_KERNEL_BEGIN(int8_t)
+    for (int g = 0; g < groups; g++)
+    {
+        __m512i b0 = _mm512_loadu_si512(&b[g * 64]);
+        for (int r = 0; r < GEMM_MR; r++)
+        {
+            int32_t quad;
+            memcpy(&quad, &a[(g * GEMM_MR + r) * 4], sizeof(quad));
+            __m512i prod = _mm512_maddubs_epi16(_mm512_set1_epi32(quad), b0);
+            c[r] = _mm512_add_epi32(c[r], _mm512_madd_epi16(prod, ones));
+        }
+    }
+    AVX512_KERNEL_END
+}
+
+__attribute__((target("avx512f,avx512bw,avx512vnni")))
+static void kernel_i16_vnni(int groups, const void *pa, const void *pb, void *pacc)
+{
+    AVX512_KERNEL_BEGIN(int16_t)
+    for (int g = 0; g < groups; g++)
+    {
+        __m512i b0 = _mm512_loadu_si512(&b[g * 32]);
+        for (int r = 0; r < GEMM_MR; r++)
+        {
+            int32_t pair;
+            memcpy(&pair, &a[(g * GEMM_MR + r) * 2], sizeof(pair));
+            c[r] = _mm512_dpwssd_epi32(c[r], _mm512_set1_epi32(pair), b0);
+        }
+    }
+    AVX512_KERNEL_END
+}
+
+__attribute__((target("avx512f,avx512bw,avx512vnni")))
+static void kernel_i8_vnni(int groups, const void *pa, const void *pb, void *pacc)
+{
+    AVX512_KERNEL_BEGIN(int8_t)
+    for (int g = 0; g < groups; g++)
+    {
+        __m512i b0 = _mm512_loadu_si512(&b[g * 64]);
+        for (int r = 0; r < GEMM_MR; r++)
+        {
+            int32_t quad;
+            memcpy(&quad, &a[(g * GEMM_MR + r) * 4], sizeof(quad));
+            c[r] = _mm512_dpbusd_epi32(c[r], _mm512_set1_epi32(quad), b0);
+        }
+    }
+    AVX512_KERNEL_END
+}
+
+__attribute__((target("avx512f")))
+static void kernel_f32_avx512(int groups, const void *pa, const void *pb, void *pacc)
+{
+    const float *a = pa, *b = pb;
+    __m512 c[GEMM_MR];
+    for (int r = 0; r < GEMM_MR; r++)
+        c[r] = _mm512_setzero_ps();
+
+    for (int g = 0; g < groups; g++)
+    {
+        __m512 b0 = _mm512_loadu_ps(&b[g * 16]);
+        for (int r = 0; r < GEMM_MR; r++)
+            c[r] = _mm512_fmadd_ps(_mm512_set1_ps(a[g * GEMM_MR + r]), b0, c[r]);
+    }
+
+    for (int r = 0; r < GEMM_MR; r++)
+        _mm512_storeu_ps((float *)pacc + 16 * r, c[r]);
+}
+
+__attribute__((target("avx512f")))
+static void kernel_f64_avx512(int groups, const void *pa, const void *pb, void *pacc)
+{
+    const double *a = pa, *b = pb;
+    __m512d c[GEMM_MR];
+    for (int r = 0; r < GEMM_MR; r++)
+        c[r] = _mm512_setzero_pd();
+
+    for (int g = 0; g < groups; g++)
+    {
+        __m512d b0 = _mm512_loadu_pd(&b[g * 8]);
+        for (int r = 0; r < GEMM_MR; r++)
+            c[r] = _mm512_fmadd_pd(_mm512_set1_pd(a[g * GEMM_MR + r]), b0, c[r]);
+    }
+
+    for (int r = 0; r < GEMM_MR; r++)
+        _mm512_storeu_pd((double *)pacc + 8 * r, c[r]);
+}
+
+// Kernel table: NULL where an ISA path has nothing to offer for an element type
+static const micro_kernel_fn micro_kernels[NUM_ELEM_TYPES][NUM_ISAS] = {
+    [ELEM_I32] = { kernel_i32_generic, kernel_i32_avx2, kernel_i32_avx512, NULL },
+    [ELEM_I16] = { kernel_i16_generic, kernel_i16_avx2, kernel_i16_avx512, kernel_i16_vnni },
+    [ELEM_I8]  = { kernel_i8_generic,  kernel_i8_avx2,  kernel_i8_avx512,  kernel_i8_vnni },
+    [ELEM_F32] = { kernel_f32_generic, kernel_f32_avx2, kernel_f32_avx512, NULL },
+    [ELEM_F64] = { kernel_f64_generic, kernel_f64_avx2, kernel_f64_avx512, NULL },
+};
+
+/**
+ * Detects the instruction sets of the host CPU (cpuid, including the OS check for
+ * saved AVX/AVX-512 register state) and selects the fastest available micro-kernel
+ * for every element type. The generic C kernel is always available.
+ */
+static void detect_isa(void)
+{
+    __builtin_cpu_init();
+    isa_available[ISA_AVX2] = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    isa_available[ISA_AVX512] = __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+    isa_available[ISA_AVX512_VNNI] = isa_available[ISA_AVX512] && __builtin_cpu_supports("avx512vnni");
+
+    for (int t = 0; t < NUM_ELEM_TYPES; t++)
+    {
+        active_isa[t] = ISA_GENERIC;
+        for (int isa = 0; isa < NUM_ISAS; isa++)
+        {
+            if (isa_available[isa] && micro_kernels[t][isa])
+                active_isa[t] = isa;
+        }
+    }
+}
+
+/**
+ * Adds (or stores, for the first KC panel) an mr x nr corner of a micro-kernel tile
+ * into the result matrix, whose element type is the accumulator type.
+ */
+static void store_tile(matrix_t *result, int i0, int j0, int mr, int nr, int nr_tile, const void *acc, int overwrite)
+{
+    for (int r = 0; r < mr; r++)
+    {
+        for (int j = 0; j < nr; j++)
+        {
+            switch (result->type)
+            {
+            case ELEM_F32:
+            {
+                float v = ((const float *)acc)[r * nr_tile + j];
+                MAT_AS(result, float, i0 + r, j0 + j) = overwrite ? v : MAT_AS(result, float, i0 + r, j0 + j) + v;
+                break;
+            }
+            case ELEM_F64:
+            {
+                double v = ((const double *)acc)[r * nr_tile + j];
+                MAT_AS(result, double, i0 + r, j0 + j) = overwrite ? v : MAT_AS(result, double, i0 + r, j0 + j) + v;
+                break;
+            }
+            default:
+            {
+                int32_t v = ((const int32_t *)acc)[r * nr_tile + j];
+                MAT_AS(result, int32_t, i0 + r, j0 + j) = overwrite ? v : MAT_AS(result, int32_t, i0 + r, j0 + j) + v;
+            }
+            }
+        }
+    }
+}
+
+// Bytes of the packed KC x NC panel of matrix2 for an n-column result
+static size_t blocked_b_pack_bytes(int n, enum elem_type type)
+{
+    int nr_tile = GEMM_TILE_BYTES / elem_sizes[elem_acc[type]];
+    int nc_max = GEMM_NC < n ? GEMM_NC : n;
+    int nc_pad = (nc_max + nr_tile - 1) / nr_tile * nr_tile;
+    return (size_t)GEMM_KC * nc_pad * elem_sizes[type];
+}
+
+// Bytes of one packed MC x KC block of matrix1
+static size_t blocked_a_pack_bytes(enum elem_type type)
+{
+    return (size_t)GEMM_MC * GEMM_KC * elem_sizes[type];
+}
+
+/**
+ * Packs the mc x kc block of matrix1 at (ic, pc) into a_pack and multiplies it with
+ * the packed kc x nc panel of matrix2 (columns jc ...) into the matching rows of result.
+ */
+static void blocked_macro_kernel(const matrix_t *matrix1, matrix_t *result, micro_kernel_fn kernel,
+                                 int ic, int mc, int jc, int nc, int pc, int kc, int nr_tile,
+                                 const char *b_pack, char *a_pack, int overwrite)
+{
+    int kg = elem_kgroup[matrix1->type];
+    int groups = (kc + kg - 1) / kg;
+    size_t sliver = (size_t)groups * kg * matrix1->esz;  // Bytes per packed row/column
+    char acc[GEMM_MR * GEMM_TILE_BYTES] __attribute__((aligned(64)));
+
+    pack_a(matrix1, ic, pc, mc, kc, kg, a_pack);
+
+    for (int jr = 0; jr < nc; jr += nr_tile)
+    {
+        int nr = (nc - jr < nr_tile) ? nc - jr : nr_tile;
+
+        for (int ir = 0; ir < mc; ir += GEMM_MR)
+        {
+            int mr = (mc - ir < GEMM_MR) ? mc - ir : GEMM_MR;
+            kernel(groups, &a_pack[ir * sliver], &b_pack[jr * sliver], acc);
+            store_tile(result, ic + ir, jc + jr, mr, nr, nr_tile, acc, overwrite);
+        }
+    }
+}
+
+/**
+ * Cache-blocked matrix multiplication with packed panels (Goto/BLIS loop order).
+ * The KC x NC panel of matrix2 is packed cooperatively by all threads, then every
+ * thread packs its own MC x KC block of matrix1 and runs the micro-kernel over it.
+ * Works for every element type; result must have the accumulator type of the inputs
+ * (int32 for integer inputs).
+ *
+ * @param m, n, k: result is m x n, matrix1 is m x k, matrix2 is k x n.
+ * @param matrix1, matrix2: Input matrices.
+ * @param result: Output matrix.
+ * @param isa: Micro-kernel to use; must be available on this CPU.
+ * @param accumulate: Non-zero to add the product to result instead of overwriting it.
+ */
+static void multiply_blocked_isa(int m, int n, int k, const matrix_t *matrix1, const matrix_t *matrix2,
+                                 matrix_t *result, enum isa_path isa, int accumulate)
+{
+    enum elem_type type = matrix1->type;
+    micro_kernel_fn kernel = micro_kernels[type][isa];
+    int kg = elem_kgroup[type];
+    int nr_tile = GEMM_TILE_BYTES / elem_sizes[elem_acc[type]];
+    char *b_pack = aligned_alloc(MATRIX_ALIGN, blocked_b_pack_bytes(n, type));
+
+    #pragma omp parallel
+    {
+        char *a_pack = aligned_alloc(MATRIX_ALIGN, blocked_a_pack_bytes(type));
+
+        for (int jc = 0; jc < n; jc += GEMM_NC)
+        {
+            int nc = (n - jc < GEMM_NC) ? n - jc : GEMM_NC;
+
+            for (int pc = 0; pc < k; pc += GEMM_KC)
+            {
+                int kc = (k - pc < GEMM_KC) ? k - pc : GEMM_KC;
+                size_t sliver = (size_t)((kc + kg - 1) / kg) * kg * matrix1->esz;
+
+                // Pack the shared panel of matrix2, one sliver per iteration
+                #pragma omp for schedule(static)
+                for (int jr = 0; jr < nc; jr += nr_tile)
+                {
+                    int nr = (nc - jr < nr_tile) ? nc - jr : nr_tile;
+                    pack_b_sliver(matrix2, pc, jc + jr, kc, nr, nr_tile, kg, &b_pack[jr * sliver]);
+                }
+
+                // Each thread takes MC-row blocks of matrix1 and updates its rows of result
+                // Static split keeps a thread on the rows it first-touched (see matrix_place)
+                // First KC panel overwrites the result (unless accumulating), later panels add to it
+                #pragma omp for schedule(static)
+                for (int ic = 0; ic < m; ic += GEMM_MC)
+                {
+                    int mc = (m - ic < GEMM_MC) ? m - ic : GEMM_MC;
+                    blocked_macro_kernel(matrix1, result, kernel, ic, mc, jc, nc, pc, kc, nr_tile,
+                                         b_pack, a_pack, pc == 0 && !accumulate);
+                }
+            }
+        }
+
+        free(a_pack);
+    }
+
+    free(b_pack);
+}
+
+/**
+ * Single-threaded entry point of the blocked kernel for callers that are already
+ * parallel (Strassen leaves run inside OpenMP tasks). No parallel region is opened
+ * and nothing is allocated: the packing buffers are owned by the caller and must
+ * hold blocked_b_pack_bytes(n, type) and blocked_a_pack_bytes(type) bytes.
+ */
+static void multiply_blocked_serial(int m, int n, int k, const matrix_t *matrix1, const matrix_t *matrix2,
+                                    matrix_t *result, enum isa_path isa, int accumulate, char *b_pack, char *a_pack)
+{
+    enum elem_type type = matrix1->type;
+    micro_kernel_fn kernel = micro_kernels[type][isa];
+    int kg = elem_kgroup[type];
+    int nr_tile = GEMM_TILE_BYTES / elem_sizes[elem_acc[type]];
+
+    for (int jc = 0; jc < n; jc += GEMM_NC)
+    {
+        int nc = (n - jc < GEMM_NC) ? n - jc : GEMM_NC;
+
+        for (int pc = 0; pc < k; pc += GEMM_KC)
+        {
+            int kc = (k - pc < GEMM_KC) ? k - pc : GEMM_KC;
+            size_t sliver = (size_t)((kc + kg - 1) / kg) * kg * matrix1->esz;
+
+            for (int jr = 0; jr < nc; jr += nr_tile)
+            {
+                int nr = (nc - jr < nr_tile) ? nc - jr : nr_tile;
+                pack_b_sliver(matrix2, pc, jc + jr, kc, nr, nr_tile, kg, &b_pack[jr * sliver]);
+            }
+
+            for (int ic = 0; ic < m; ic += GEMM_MC)
+            {
+                int mc = (m - ic < GEMM_MC) ? m - ic : GEMM_MC;
+                blocked_macro_kernel(matrix1, result, kernel, ic, mc, jc, nc, pc, kc, nr_tile,
+                                     b_pack, a_pack, pc == 0 && !accumulate);
+            }
+        }
+    }
+}
+
+/**
+ * Blocked int32 multiplication with the micro-kernel selected for this CPU.
+ */
+static void multiply_blocked(int n, const matrix_t *matrix1, const matrix_t *matrix2, matrix_t *result)
+{
+    multiply_blocked_isa(n, n, n, matrix1, matrix2, result, active_isa[ELEM_I32], 0);
+}
+
+/**
+ * Bump allocator for Strassen scratch space.
+ * One buffer is allocated up front; every recursion level carves its temporaries
+ * and the sub-arenas of its children out of the arena it was given.
+ */
+typedef struct
+{
+    int *base;
+    size_t size, used;
+} arena_t;
+
+// Elements taken by one h x h temporary (rows padded to whole cache lines)
+static size_t arena_matrix_elems(int h)
+{
+    int line = MATRIX_ALIGN / sizeof(int);
+    return (size_t)h * ((h + line - 1) / line * line);
+}
+
+// Elements of a leaf's packing buffers, rounded to whole cache lines to keep the arena aligned
+static size_t arena_pack_elems(size_t bytes)
+{
+    return (bytes + MATRIX_ALIGN - 1) / MATRIX_ALIGN * MATRIX_ALIGN / sizeof(int);
+}
+
+static matrix_t arena_matrix(arena_t *arena, int h)
+{
+    int line = MATRIX_ALIGN / sizeof(int);
+    matrix_t m;
+    m.rows = m.cols = h;
+    m.ld = (h + line - 1) / line * line;
+    m.layout = ROW_MAJOR;
+    m.type = ELEM_I32;
+    m.esz = sizeof(int);
+    m.rs = m.ld;
+    m.cs = 1;
+    m.data = arena->base + arena->used;
+    arena->used += arena_matrix_elems(h);
+    return m;
+}
+
+static arena_t arena_take(arena_t *arena, size_t elems)
+{
+    arena_t sub = { arena->base + arena->used, elems, 0 };
+    arena->used += elems;
+    return sub;
+}
+
+/**
+ * Scratch elements needed to multiply two n x n matrices with strassen_rec().
+ * Task levels hold 8 operand sums and 7 products so the products can run concurrently;
+ * sequential levels use the two-temporary Winograd schedule. A leaf holds the packing
+ * buffers of the blocked kernel; leaves below one task run one after another and share them.
+ */
+static size_t strassen_scratch(int n, int task_levels, int crossover)
+{
+    if (n <= crossover)
+        return arena_pack_elems(blocked_b_pack_bytes(n, ELEM_I32)) + arena_pack_elems(blocked_a_pack_bytes(ELEM_I32));
+
+    int h = n / 2;
+    if (task_levels > 0)
+        return 15 * arena_matrix_elems(h) + 7 * strassen_scratch(h, task_levels - 1, crossover);
+    return 2 * arena_matrix_elems(h) + strassen_scratch(h, 0, crossover);
+}
+
+// Sub-matrix sharing the storage of m
+static matrix_t matrix_view(const matrix_t *m, int i0, int j0, int rows, int cols)
+{
+    matrix_t v = *m;
+    v.rows = rows;
+    v.cols = cols;
+    v.data = (char *)m->data + ((size_t)i0 * m->rs + (size_t)j0 * m->cs) * m->esz;
+    return v;
+}
+
+// c = a + sign * b, element-wise on int32 matrices (c may alias a or b)
+static void matrix_addsub(matrix_t *c, const matrix_t *a, const matrix_t *b, int sign)
+{
+    for (int i = 0; i < c->rows; i++)
+    {
+        #pragma omp simd
+        for (int j = 0; j < c->cols; j++)
+        {
+            MAT(c, i, j) = MAT(a, i, j) + sign * MAT(b, i, j);
+        }
+    }
+}
+
+/**
+ * Strassen-Winograd recursion: C = A * B for n x n int32 matrices, 7 half-size
+ * products and 15 additions per level. Below the crossover size the single-threaded blocked
+ * kernel is used, with packing buffers carved from the arena.
+ * The top `task_levels` levels run their 7 products as OpenMP tasks; deeper levels
+ * are sequential inside the task that reached them.
+ */
+static void strassen_rec(int n, const matrix_t *A, const matrix_t *B, matrix_t *C,
+                         arena_t arena, int task_levels, int crossover)
 {
-    // Array of matrix sizes to be tested
-    int matrix_sizes[] = { 100, 400, 1600, 3200 };
-    int num_sizes = sizeof(matrix_sizes) / sizeof(matrix_sizes[0]);
+    if (n <= crossover)
+    {
+        arena_t b_pack = arena_take(&arena, arena_pack_elems(blocked_b_pack_bytes(n, ELEM_I32)));
+        arena_t a_pack = arena_take(&arena, arena_pack_elems(blocked_a_pack_bytes(ELEM_I32)));
+        multiply_blocked_serial(n, n, n, A, B, C, active_isa[ELEM_I32], 0, (char *)b_pack.base, (char *)a_pack.base);
+        return;
+    }
 
-    // Print table header
-    printf("\n");
-    printf("+------------+------------+------------+------------+------------+\n");
-    printf("| %10s | %10s | %10s | %10s | %10s |\n","MatrixSize", "1 Thread", "2 Thread", "4 Thread", "8 Thread" );
-    printf("+------------+------------+------------+------------+------------+\n");
+    int h = n / 2;
+    matrix_t A11 = matrix_view(A, 0, 0, h, h), A12 = matrix_view(A, 0, h, h, h);
+    matrix_t A21 = matrix_view(A, h, 0, h, h), A22 = matrix_view(A, h, h, h, h);
+    matrix_t B11 = matrix_view(B, 0, 0, h, h), B12 = matrix_view(B, 0, h, h, h);
+    matrix_t B21 = matrix_view(B, h, 0, h, h), B22 = matrix_view(B, h, h, h, h);
+    matrix_t C11 = matrix_view(C, 0, 0, h, h), C12 = matrix_view(C, 0, h, h, h);
+    matrix_t C21 = matrix_view(C, h, 0, h, h), C22 = matrix_view(C, h, h, h, h);
 
-    // Iterate over different matrix sizes
-    for (int i = 0; i < num_sizes; i++)
+    if (task_levels > 0)
     {
-        matrix_multiply(matrix_sizes[i], matrix_sizes[i]);
+        matrix_t S[4], T[4], P[7];
+        for (int i = 0; i < 4; i++)
+        {
+            S[i] = arena_matrix(&arena, h);
+            T[i] = arena_matrix(&arena, h);
+        }
+        for (int i = 0; i < 7; i++)
+            P[i] = arena_matrix(&arena, h);
+
+        // Operand sums: two dependency chains, one per input
+        #pragma omp task shared(S, A11, A12, A21, A22)
+        {
+            matrix_addsub(&S[0], &A21, &A22, 1);   // S1 = A21 + A22
+            matrix_addsub(&S[1], &S[0], &A11, -1); // S2 = S1 - A11
+            matrix_addsub(&S[2], &A11, &A21, -1);  // S3 = A11 - A21
+            matrix_addsub(&S[3], &A12, &S[1], -1); // S4 = A12 - S2
+        }
+        #pragma omp task shared(T, B11, B12, B21, B22)
+        {
+            matrix_addsub(&T[0], &B12, &B11, -1);  // T1 = B12 - B11
+            matrix_addsub(&T[1], &B22, &T[0], -1); // T2 = B22 - T1
+            matrix_addsub(&T[2], &B22, &B12, -1);  // T3 = B22 - B12
+            matrix_addsub(&T[3], &T[1], &B21, -1); // T4 = T2 - B21
+        }
+        #pragma omp taskwait
+
+        // The seven products, each with its own slice of the arena
+        const matrix_t *lhs[7] = { &A11, &A12, &S[3], &A22, &S[0], &S[1], &S[2] };
+        const matrix_t *rhs[7] = { &B11, &B21, &B22, &T[3], &T[0], &T[1], &T[2] };
+        for (int i = 0; i < 7; i++)
+        {
+            arena_t sub = arena_take(&arena, strassen_scratch(h, task_levels - 1, crossover));
+            #pragma omp task shared(lhs, rhs, P)
+            strassen_rec(h, lhs[i], rhs[i], &P[i], sub, task_levels - 1, crossover);
+        }
+        #pragma omp taskwait
+
+        // Combine: each quadrant is formed independently from the products
+        #pragma omp task shared(P, C11)
+        matrix_addsub(&C11, &P[0], &P[1], 1);    // C11 = P1 + P2
+        #pragma omp task shared(P, C12)
+        {
+            matrix_addsub(&C12, &P[0], &P[5], 1);  // U2 = P1 + P6
+            matrix_addsub(&C12, &C12, &P[4], 1);   // U4 = U2 + P5
+            matrix_addsub(&C12, &C12, &P[2], 1);   // C12 = U4 + P3
+        }
+        #pragma omp task shared(P, C21)
+        {
+            matrix_addsub(&C21, &P[0], &P[5], 1);  // U2 = P1 + P6
+            matrix_addsub(&C21, &C21, &P[6], 1);   // U3 = U2 + P7
+            matrix_addsub(&C21, &C21, &P[3], -1);  // C21 = U3 - P4
+        }
+        #pragma omp task shared(P, C22)
+        {
+            matrix_addsub(&C22, &P[0], &P[5], 1);  // U2 = P1 + P6
+            matrix_addsub(&C22, &C22, &P[6], 1);   // U3 = U2 + P7
+            matrix_addsub(&C22, &C22, &P[4], 1);   // C22 = U3 + P5
+        }
+        #pragma omp taskwait
+        return;
     }
 
-    printf("+------------+------------+------------+------------+------------+\n");
-    return 0;
+    // Sequential level: Winograd schedule with two temporaries, using the
+    // quadrants of C to hold intermediate products
+    matrix_t X = arena_matrix(&arena, h);
+    matrix_t Y = arena_matrix(&arena, h);
+
+    matrix_addsub(&X, &A11, &A21, -1);                     // X = S3
+    matrix_addsub(&Y, &B22, &B12, -1);                     // Y = T3
+    strassen_rec(h, &X, &Y, &C21, arena, 0, crossover);    // C21 = P7
+    matrix_addsub(&X, &A21, &A22, 1);                      // X = S1
+    matrix_addsub(&Y, &B12, &B11, -1);                     // Y = T1
+    strassen_rec(h, &X, &Y, &C22, arena, 0, crossover);    // C22 = P5
+    matrix_addsub(&X, &X, &A11, -1);                       // X = S2
+    matrix_addsub(&Y, &B22, &Y, -1);                       // Y = T2
+    strassen_rec(h, &X, &Y, &C12, arena, 0, crossover);    // C12 = P6
+    matrix_addsub(&X, &A12, &X, -1);                       // X = S4
+    strassen_rec(h, &X, &B22, &C11, arena, 0, crossover);  // C11 = P3
+    strassen_rec(h, &A11, &B11, &X, arena, 0, crossover);  // X = P1
+    matrix_addsub(&C12, &X, &C12, 1);                      // C12 = U2 = P1 + P6
+    matrix_addsub(&C21, &C12, &C21, 1);                    // C21 = U3 = U2 + P7
+    matrix_addsub(&C12, &C12, &C22, 1);                    // C12 = U4 = U2 + P5
+    matrix_addsub(&C22, &C21, &C22, 1);                    // C22 = U7 = U3 + P5
+    matrix_addsub(&C12, &C12, &C11, 1);                    // C12 = U5 = U4 + P3
+    matrix_addsub(&Y, &Y, &B21, -1);                       // Y = T4
+    strassen_rec(h, &A22, &Y, &C11, arena, 0, crossover);  // C11 = P4
+    matrix_addsub(&C21, &C21, &C11, -1);                   // C21 = U6 = U3 - P4
+    strassen_rec(h, &A12, &B21, &C11, arena, 0, crossover);// C11 = P2
+    matrix_addsub(&C11, &X, &C11, 1);                      // C11 = U1 = P1 + P2
 }
 
 /**
- * Function to perform matrix multiplication and measure execution time using OpenMP.
- * The function dynamically allocates memory for matrices, initializes them, performs 
- * multiplication with different numbers of threads, and prints the execution times.
+ * Everything the Strassen mode needs for one matrix size, allocated once before timing:
+ * zero-padded copies of the operands (when n is not crossover * 2^levels) and the arena.
+ */
+typedef struct
+{
+    int n, m;
+    int crossover;
+    matrix_t a, b, c;
+    arena_t arena;
+} strassen_plan_t;
+
+static strassen_plan_t strassen_plan_create(int n, int crossover)
+{
+    strassen_plan_t plan;
+    int levels = 0;
+    while ((n + (1 << levels) - 1) >> levels > crossover)
+        levels++;
+
+    plan.n = n;
+    plan.crossover = crossover;
+    plan.m = ((n + (1 << levels) - 1) >> levels) << levels;
+    if (plan.m != n)
+    {
+        plan.a = matrix_create(plan.m, plan.m, ROW_MAJOR, use_huge_pages);
+        plan.b = matrix_create(plan.m, plan.m, ROW_MAJOR, use_huge_pages);
+        plan.c = matrix_create(plan.m, plan.m, ROW_MAJOR, use_huge_pages);
+    }
+
+    plan.arena.size = strassen_scratch(plan.m, STRASSEN_TASK_LEVELS, crossover);
+    plan.arena.used = 0;
+    size_t bytes = (plan.arena.size * sizeof(int) + MATRIX_ALIGN) / MATRIX_ALIGN * MATRIX_ALIGN;
+    plan.arena.base = aligned_alloc(MATRIX_ALIGN, bytes);
+    return plan;
+}
+
+static void strassen_plan_free(strassen_plan_t *plan)
+{
+    if (plan->m != plan->n)
+    {
+        matrix_free(&plan->a);
+        matrix_free(&plan->b);
+        matrix_free(&plan->c);
+    }
+    free(plan->arena.base);
+}
+
+/**
+ * Strassen-Winograd multiplication of int32 matrices. Results are exactly those of
+ * the classical algorithm, since every intermediate is an integer sum.
  *
- * @param rows: Number of rows in the matrices.
- * @param cols: Number of columns in the matrices.
+ * @param n: Dimension of the square matrices.
+ * @param matrix1, matrix2: Input matrices.
+ * @param result: Output matrix.
+ * @param plan: Scratch space from strassen_plan_create(n, ...).
  */
-void matrix_multiply(int rows, int cols)
+static void multiply_strassen(int n, const matrix_t *matrix1, const matrix_t *matrix2, matrix_t *result,
+                              strassen_plan_t *plan)
 {
-    int i, j, k;
+    const matrix_t *a = matrix1, *b = matrix2;
+    matrix_t *c = result;
+
+    // Copy into the padded operands; the padding rows and columns stay zero
+    if (plan->m != n)
+    {
+        #pragma omp parallel for schedule(static)
+        for (int i = 0; i < n; i++)
+        {
+            for (int j = 0; j < n; j++)
+            {
+                MAT(&plan->a, i, j) = MAT(matrix1, i, j);
+                MAT(&plan->b, i, j) = MAT(matrix2, i, j);
+            }
+        }
+        a = &plan->a;
+        b = &plan->b;
+        c = &plan->c;
+    }
 
-    // Dynamically allocate memory for three matrices: matrix1, matrix2, and result.
-    int **matrix1 = (int **)malloc(rows * sizeof(int *));
-    int **matrix2 = (int **)malloc(rows * sizeof(int *));
-    int **result = (int **)malloc(rows * sizeof(int *));
-    
-    for (i = 0; i < rows; i++)
+    // A matrix at or below the crossover is a single leaf: run it on the whole team
+    if (plan->m <= plan->crossover)
+    {
+        multiply_blocked(plan->m, a, b, c);
+    }
+    else
     {
-        matrix1[i] = (int *)malloc(cols * sizeof(int));
-        matrix2[i] = (int *)malloc(cols * sizeof(int));
-        result[i] = (int *)malloc(cols * sizeof(int));
+        #pragma omp parallel
+        #pragma omp single
+        strassen_rec(plan->m, a, b, c, plan->arena, STRASSEN_TASK_LEVELS, plan->crossover);
     }
 
-    // Initialize matrices with random values
-    // OpenMP is used to parallelize the nested loop using collapse(2), 
-    // which combines both loops into a single iteration space.
-    #pragma omp parallel for collapse(2)
-    for (i = 0; i < rows; i++)
+    if (plan->m != n)
     {
-        for (j = 0; j < cols; j++)
+        #pragma omp parallel for schedule(static)
+        for (int i = 0; i < n; i++)
         {
-            matrix1[i][j] = rand() % 100;  // Assign random values
-            matrix2[i][j] = rand() % 100;
-            result[i][j] = 0;  // Initialize result matrix
+            for (int j = 0; j < n; j++)
+            {
+                MAT(result, i, j) = MAT(&plan->c, i, j);
+            }
         }
     }
+}
+
+/**
+ * Compressed sparse int32 matrix.
+ * ROW_MAJOR is CSR: ptr has rows + 1 offsets into idx/val and idx holds column indices.
+ * COL_MAJOR is CSC: ptr has cols + 1 offsets and idx holds row indices.
+ */
+typedef struct
+{
+    int rows, cols;
+    enum matrix_layout layout;
+    size_t nnz;
+    size_t *ptr;
+    int *idx;
+    int *val;
+} sparse_t;
 
-    // Array containing different numbers of threads to be tested
-    int num_threads[] = {1, 2, 4, 8};
-    double times[4]; // Array to store execution times
+// Number of compressed rows (CSR) or columns (CSC), and the length of each of them
+static int sparse_outer(const sparse_t *s)
+{
+    return s->layout == ROW_MAJOR ? s->rows : s->cols;
+}
 
-    // Perform matrix multiplication with different thread counts
-    for (int t = 0; t < 4; t++)
+static int sparse_inner(const sparse_t *s)
+{
+    return s->layout == ROW_MAJOR ? s->cols : s->rows;
+}
+
+static void sparse_free(sparse_t *s)
+{
+    free(s->ptr);
+    free(s->idx);
+    free(s->val);
+    s->ptr = NULL;
+    s->idx = s->val = NULL;
+}
+
+/**
+ * Compresses the nonzeros of an int32 matrix into CSR (layout ROW_MAJOR) or CSC
+ * (layout COL_MAJOR). Counting and filling are split statically over the outer index.
+ */
+static sparse_t sparse_from_dense(const matrix_t *m, enum matrix_layout layout)
+{
+    sparse_t s = { m->rows, m->cols, layout, 0, NULL, NULL, NULL };
+    int outer = sparse_outer(&s), inner = sparse_inner(&s);
+    size_t ors = (layout == ROW_MAJOR) ? m->rs : m->cs, irs = (layout == ROW_MAJOR) ? m->cs : m->rs;
+    const int *data = m->data;
+
+    s.ptr = malloc((outer + 1) * sizeof(size_t));
+    s.ptr[0] = 0;
+    #pragma omp parallel for schedule(static)
+    for (int o = 0; o < outer; o++)
     {
-        double start_time = omp_get_wtime();  // Start timing
-        omp_set_num_threads(num_threads[t]);  // Set the number of threads
+        size_t count = 0;
+        for (int q = 0; q < inner; q++)
+            count += data[o * ors + q * irs] != 0;
+        s.ptr[o + 1] = count;
+    }
+    for (int o = 0; o < outer; o++)
+        s.ptr[o + 1] += s.ptr[o];
 
-        // Parallelizing the outer loops using OpenMP
-        // `collapse(2)` ensures that both row and column loops are parallelized together
-        // `schedule(static)` ensures uniform workload distribution among threads
-        #pragma omp parallel for collapse(2) schedule(static)
-        for (i = 0; i < rows; i++)
+    s.nnz = s.ptr[outer];
+    s.idx = malloc((s.nnz + 1) * sizeof(int));
+    s.val = malloc((s.nnz + 1) * sizeof(int));
+    #pragma omp parallel for schedule(static)
+    for (int o = 0; o < outer; o++)
+    {
+        size_t pos = s.ptr[o];
+        for (int q = 0; q < inner; q++)
+        {
+            int v = data[o * ors + q * irs];
+            if (v != 0)
+            {
+                s.idx[pos] = q;
+                s.val[pos++] = v;
+            }
+        }
+    }
+    return s;
+}
+
+/**
+ * First index of part p when [0, n) is cut into `parts` ranges of about equal weight,
+ * where prefix[i] is the total weight of the indices below i. With prefix = ptr this
+ * balances nonzeros instead of rows, so a few dense rows do not land on one thread.
+ */
+static int balanced_split(const size_t *prefix, int n, int parts, int p)
+{
+    if (p >= parts)
+        return n;
+
+    size_t target = prefix[n] * p / parts;
+    int lo = 0, hi = n;
+    while (lo < hi)
+    {
+        int mid = lo + (hi - lo) / 2;
+        if (prefix[mid] < target)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/**
+ * Dense matrix-vector product y = A x, the baseline for sparse_mv.
+ */
+static void multiply_dense_mv(const matrix_t *a, const int *x, int *y)
+{
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < a->rows; i++)
+    {
+        int sum = 0;
+        #pragma omp simd reduction(+ : sum)
+        for (int j = 0; j < a->cols; j++)
+            sum += MAT(a, i, j) * x[j];
+        y[i] = sum;
+    }
+}
+
+/**
+ * Sparse matrix-vector product y = A x, with every thread given an equal share of
+ * the nonzeros. CSR writes each y[i] from one thread. CSC scatters into y, so every
+ * thread accumulates its columns into a private vector and the vectors are summed
+ * row-wise afterwards.
+ */
+static void sparse_mv(const sparse_t *a, const int *x, int *y)
+{
+    int outer = sparse_outer(a);
+    int **partial = (a->layout == COL_MAJOR) ? malloc(omp_get_max_threads() * sizeof(int *)) : NULL;
+
+    #pragma omp parallel
+    {
+        int parts = omp_get_num_threads(), p = omp_get_thread_num();
+        int lo = balanced_split(a->ptr, outer, parts, p), hi = balanced_split(a->ptr, outer, parts, p + 1);
+
+        if (a->layout == ROW_MAJOR)
         {
-            for (j = 0; j < cols; j++)
+            for (int i = lo; i < hi; i++)
+            {
+                int sum = 0;
+                for (size_t q = a->ptr[i]; q < a->ptr[i + 1]; q++)
+                    sum += a->val[q] * x[a->idx[q]];
+                y[i] = sum;
+            }
+        }
+        else
+        {
+            int *part = calloc(a->rows, sizeof(int));
+            partial[p] = part;
+            for (int j = lo; j < hi; j++)
+            {
+                int xj = x[j];
+                for (size_t q = a->ptr[j]; q < a->ptr[j + 1]; q++)
+                    part[a->idx[q]] += a->val[q] * xj;
+            }
+
+            #pragma omp barrier
+            #pragma omp for schedule(static)
+            for (int i = 0; i < a->rows; i++)
             {
                 int sum = 0;
+                for (int t = 0; t < parts; t++)
+                    sum += partial[t][i];
+                y[i] = sum;
+            }
+            free(part);
+        }
+    }
+
+    free(partial);
+}
+
+/**
+ * Sparse matrix product C = A B (Gustavson's algorithm). Both operands and the result
+ * share one layout. Row i of a CSR result is the sum of the rows of B selected by the
+ * nonzeros of row i of A. A CSC matrix is the CSR of its transpose, so a CSC product is
+ * computed as C^T = B^T A^T with the same code.
+ *
+ * Every thread owns a dense accumulator and a marker array the length of one output
+ * row. The output rows are split by the number of multiply-adds they need rather than
+ * by count. A symbolic pass sizes each row, then a numeric pass fills it. Column
+ * indices within a row are in first-touched order, not sorted.
+ */
+static sparse_t sparse_multiply(const sparse_t *A, const sparse_t *B)
+{
+    const sparse_t *a = (A->layout == ROW_MAJOR) ? A : B;
+    const sparse_t *b = (A->layout == ROW_MAJOR) ? B : A;
+    int outer = sparse_outer(a), inner = sparse_inner(b);
+    sparse_t c = { A->rows, B->cols, A->layout, 0, NULL, NULL, NULL };
+
+    // Work of output row i: the lengths of the rows of b that row i of a selects
+    size_t *work = malloc((outer + 1) * sizeof(size_t));
+    c.ptr = malloc((outer + 1) * sizeof(size_t));
+    work[0] = c.ptr[0] = 0;
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < outer; i++)
+    {
+        size_t w = 0;
+        for (size_t q = a->ptr[i]; q < a->ptr[i + 1]; q++)
+            w += b->ptr[a->idx[q] + 1] - b->ptr[a->idx[q]];
+        work[i + 1] = w;
+    }
+    for (int i = 0; i < outer; i++)
+        work[i + 1] += work[i];
+
+    #pragma omp parallel
+    {
+        int parts = omp_get_num_threads(), p = omp_get_thread_num();
+        int lo = balanced_split(work, outer, parts, p), hi = balanced_split(work, outer, parts, p + 1);
+        int *acc = malloc((inner + 1) * sizeof(int));
+        int *mark = malloc((inner + 1) * sizeof(int));
+
+        // Symbolic pass: mark[j] == i once column j has been seen in row i
+        for (int j = 0; j < inner; j++)
+            mark[j] = -1;
+        for (int i = lo; i < hi; i++)
+        {
+            size_t count = 0;
+            for (size_t q = a->ptr[i]; q < a->ptr[i + 1]; q++)
+            {
+                int k = a->idx[q];
+                for (size_t r = b->ptr[k]; r < b->ptr[k + 1]; r++)
+                {
+                    int j = b->idx[r];
+                    if (mark[j] != i)
+                    {
+                        mark[j] = i;
+                        count++;
+                    }
+                }
+            }
+            c.ptr[i + 1] = count;
+        }
+
+        #pragma omp barrier
+        #pragma omp single
+        {
+            for (int i = 0; i < outer; i++)
+                c.ptr[i + 1] += c.ptr[i];
+            c.nnz = c.ptr[outer];
+            c.idx = malloc((c.nnz + 1) * sizeof(int));
+            c.val = malloc((c.nnz + 1) * sizeof(int));
+        }
 
-                // The innermost loop performs the multiplication and summation
-                // Using `#pragma omp simd reduction(+:sum)` enables SIMD vectorization
-                // `reduction(+:sum)` ensures that different threads sum correctly
-                #pragma omp simd reduction(+:sum)
-                for (k = 0; k < cols; k++)
+        // Numeric pass: the columns of row i are appended to c.idx as they are first seen
+        for (int j = 0; j < inner; j++)
+            mark[j] = -1;
+        for (int i = lo; i < hi; i++)
+        {
+            int *cols = &c.idx[c.ptr[i]];
+            int count = 0;
+            for (size_t q = a->ptr[i]; q < a->ptr[i + 1]; q++)
+            {
+                int k = a->idx[q], av = a->val[q];
+                for (size_t r = b->ptr[k]; r < b->ptr[k + 1]; r++)
                 {
-                    sum += matrix1[i][k] * matrix2[k][j];
+                    int j = b->idx[r];
+                    if (mark[j] != i)
+                    {
+                        mark[j] = i;
+                        acc[j] = 0;
+                        cols[count++] = j;
+                    }
+                    acc[j] += av * b->val[r];
                 }
+            }
+            for (int t = 0; t < count; t++)
+                c.val[c.ptr[i] + t] = acc[cols[t]];
+        }
+
+        free(acc);
+        free(mark);
+    }
+
+    free(work);
+    return c;
+}
+
+#ifndef MATRIX_MULTIPLY_NO_MAIN
+/**
+ * Pins the threads of the OpenMP pool to CPUs. Later teams of any size reuse the
+ * pool's threads, so thread t keeps its CPU for every thread count.
+ *
+ * @param mode: BIND_CLOSE (thread t on CPU t) or BIND_SPREAD (evenly over all CPUs).
+ * @param threads: Size of the widest team.
+ */
+static void pin_threads(enum binding mode, int threads)
+{
+    if (mode == BIND_NONE)
+        return;
+
+    int ncpu = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    #pragma omp parallel num_threads(threads)
+    {
+        int t = omp_get_thread_num();
+        int cpu = (mode == BIND_CLOSE) ? t % ncpu : (int)((long)t * ncpu / threads) % ncpu;
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        if (sched_setaffinity(0, sizeof(set), &set) != 0 && t == 0)
+            perror("Warning: sched_setaffinity");
+    }
+}
+
+/**
+ * Times the blocked kernel for every element type and every ISA path at size n,
+ * using all available threads, and prints one table row per element type.
+ * Paths without a kernel for that type print "-", paths the CPU lacks print "n/a".
+ */
+static void isa_benchmark(int n)
+{
+    for (int t = 0; t < NUM_ELEM_TYPES; t++)
+    {
+        matrix_t matrix1 = matrix_create_typed(n, n, t, ROW_MAJOR, use_huge_pages);
+        matrix_t matrix2 = matrix_create_typed(n, n, t, ROW_MAJOR, use_huge_pages);
+        matrix_t result = matrix_create_typed(n, n, elem_acc[t], ROW_MAJOR, use_huge_pages);
+
+        matrix_fill_random(&matrix1, 1);
+        matrix_fill_random(&matrix2, 2);
 
-                result[i][j] = sum;  // Store the computed value in the result matrix
+        printf("| %10s | %10d |", elem_names[t], n);
+        for (int isa = 0; isa < NUM_ISAS; isa++)
+        {
+            if (!micro_kernels[t][isa])
+            {
+                printf(" %10s |", "-");
+                continue;
+            }
+            if (!isa_available[isa])
+            {
+                printf(" %10s |", "n/a");
+                continue;
+            }
+            double start_time = omp_get_wtime();
+            multiply_blocked_isa(n, n, n, &matrix1, &matrix2, &result, isa, 0);
+            printf(" %10.6f |", omp_get_wtime() - start_time);
+        }
+        printf("\n");
+
+        matrix_free(&matrix1);
+        matrix_free(&matrix2);
+        matrix_free(&result);
+    }
+}
+#endif
+
+/**
+ * Function to perform matrix multiplication and measure execution time using OpenMP.
+ * The function allocates the matrices, initializes them, performs multiplication
+ * with different numbers of threads, and prints the execution times.
+ *
+ * @param rows: Number of rows in the matrices.
+ * @param cols: Number of columns in the matrices.
+ * @param mode: Kernel used for the multiplication (see enum kernel_mode).
+ */
+void matrix_multiply(int rows, int cols, int mode)
+{
+    int i;
+
+    // matrix2 is stored column-major for `naive-col`, so its columns are contiguous
+    enum matrix_layout layout2 = (mode == MODE_NAIVE_COL) ? COL_MAJOR : ROW_MAJOR;
+    matrix_t matrix1 = matrix_create(rows, cols, ROW_MAJOR, use_huge_pages);
+    matrix_t matrix2 = matrix_create(rows, cols, layout2, use_huge_pages);
+    matrix_t result = matrix_create(rows, cols, ROW_MAJOR, use_huge_pages);
+
+    // Initialize matrices with random values from the counter-based generator
+    // Rows are split statically over the widest team, like the compute loops,
+    // instead of using whatever thread count the previous run left behind.
+    matrix_fill_random(&matrix1, 1);
+    matrix_fill_random(&matrix2, 2);
+    check_init_checksums(&matrix1, &matrix2);
+
+    // The baseline works on int** views with one malloc per row, like the original code
+    int **rp1 = NULL, **rp2 = NULL, **rp3 = NULL;
+    if (mode == MODE_ROWPTR)
+    {
+        rp1 = (int **)malloc(rows * sizeof(int *));
+        rp2 = (int **)malloc(rows * sizeof(int *));
+        rp3 = (int **)malloc(rows * sizeof(int *));
+        for (i = 0; i < rows; i++)
+        {
+            rp1[i] = (int *)malloc(cols * sizeof(int));
+            rp2[i] = (int *)malloc(cols * sizeof(int));
+            rp3[i] = (int *)calloc(cols, sizeof(int));
+            memcpy(rp1[i], &MAT(&matrix1, i, 0), cols * sizeof(int));
+            memcpy(rp2[i], &MAT(&matrix2, i, 0), cols * sizeof(int));
+        }
+    }
+
+    // Strassen scratch space is allocated once, outside the timed region
+    strassen_plan_t plan;
+    if (mode == MODE_STRASSEN)
+        plan = strassen_plan_create(rows, strassen_crossover);
+
+    double times[NUM_THREAD_COUNTS]; // Array to store execution times
+    uint64_t checksums[NUM_THREAD_COUNTS];
+    int failed = 0;
+
+    // Perform matrix multiplication with different thread counts
+    for (int t = 0; t < NUM_THREAD_COUNTS; t++)
+    {
+        // Poison the result so an element a kernel forgets to write cannot keep
+        // the correct value of the previous thread count
+        if (verify_results)
+        {
+            memset(result.data, 0xff, (size_t)result.rows * result.ld * sizeof(int));
+            if (mode == MODE_ROWPTR)
+            {
+                for (i = 0; i < rows; i++)
+                    memset(rp3[i], 0xff, cols * sizeof(int));
             }
         }
 
+        double start_time = omp_get_wtime();  // Start timing
+        omp_set_num_threads(thread_counts[t]);  // Set the number of threads
+
+        switch (mode)
+        {
+        case MODE_ROWPTR:
+            multiply_rowptr(rows, rp1, rp2, rp3);
+            break;
+        case MODE_BLOCKED:
+            multiply_blocked(rows, &matrix1, &matrix2, &result);
+            break;
+        case MODE_STRASSEN:
+            multiply_strassen(rows, &matrix1, &matrix2, &result, &plan);
+            break;
+        default:
+            multiply_naive(rows, &matrix1, &matrix2, &result);
+        }
+
         double end_time = omp_get_wtime();  // End timing
         times[t] = end_time - start_time;  // Store execution time
+
+        if (verify_results)
+        {
+            if (mode == MODE_ROWPTR)
+            {
+                for (i = 0; i < rows; i++)
+                    memcpy(&MAT(&result, i, 0), rp3[i], cols * sizeof(int));
+            }
+
+            // Every thread count must give a correct product with the same checksum
+            long bad_rows = freivalds_check(&matrix1, &matrix2, &result, FREIVALDS_TRIALS);
+            checksums[t] = matrix_checksum(&result);
+            if (bad_rows > 0 || checksums[t] != checksums[0])
+            {
+                fprintf(stderr, "Error: %s %dx%d with %d threads: %ld row mismatches in %d Freivalds trials, checksum 0x%016llx\n",
+                        mode_names[mode], rows, cols, thread_counts[t], bad_rows, FREIVALDS_TRIALS, (unsigned long long)checksums[t]);
+                failed = 1;
+            }
+        }
     }
 
     // Print execution times for different thread counts
-    printf("| %10d | %10.6f | %10.6f | %10.6f | %10.6f |\n", 
-            rows, times[0], times[1], times[2], times[3]);
+    printf("| %10s | %10s | %10d | %10.6f | %10.6f | %10.6f | %10.6f |",
+            mode_names[mode], placement_names[matrix_placement], rows, times[0], times[1], times[2], times[3]);
+    if (!verify_results)
+        printf("\n");
+    else if (failed)
+        printf(" %18s |\n", "FAILED");
+    else
+        printf(" 0x%016llx |\n", (unsigned long long)checksums[0]);
+    verify_failures += failed;
+
+    // Free allocated memory to prevent memory leaks
+    if (mode == MODE_ROWPTR)
+    {
+        for (i = 0; i < rows; i++)
+        {
+            free(rp1[i]);
+            free(rp2[i]);
+            free(rp3[i]);
+        }
+        free(rp1);
+        free(rp2);
+        free(rp3);
+    }
+    if (mode == MODE_STRASSEN)
+        strassen_plan_free(&plan);
+    matrix_free(&matrix1);
+    matrix_free(&matrix2);
+    matrix_free(&result);
+}
+
+// Products per timing of the matrix-vector kernels, which are too short to time alone
+#define MV_REPEATS 20
+
+/**
+ * Compares a CSR matrix with a dense one: every stored entry must equal the dense
+ * element, each column may appear once per row, and every dense element without an
+ * entry must be zero. Returns the number of mismatching rows.
+ */
+static long sparse_mismatches(const sparse_t *s, const matrix_t *d)
+{
+    long bad = 0;
+
+    #pragma omp parallel reduction(+ : bad)
+    {
+        // seen[j] == i + 1 marks column j as stored in row i
+        int *seen = calloc(s->cols, sizeof(int));
+
+        #pragma omp for schedule(static)
+        for (int i = 0; i < s->rows; i++)
+        {
+            int ok = 1;
+            for (size_t q = s->ptr[i]; q < s->ptr[i + 1]; q++)
+            {
+                int j = s->idx[q];
+                if (seen[j] == i + 1 || s->val[q] != MAT(d, i, j))
+                    ok = 0;
+                seen[j] = i + 1;
+            }
+            for (int j = 0; j < s->cols; j++)
+            {
+                if (seen[j] != i + 1 && MAT(d, i, j) != 0)
+                    ok = 0;
+            }
+            bad += !ok;
+        }
+        free(seen);
+    }
+
+    return bad;
+}
+
+// Number of elements in which two vectors of length n differ
+static long vector_mismatches(const int *a, const int *b, int n)
+{
+    long bad = 0;
+    for (int i = 0; i < n; i++)
+        bad += a[i] != b[i];
+    return bad;
+}
+
+/**
+ * Times dense and sparse kernels on inputs with the given fraction of nonzeros and
+ * prints one table row: blocked GEMM vs CSR SpGEMM, and dense matrix-vector vs CSR
+ * and CSC SpMV. Compression happens outside the timed region.
+ *
+ * With --verify the dense product must pass Freivalds' test, the SpGEMM product must
+ * match it entry for entry, and every matrix-vector product must match a serial
+ * reference; a Check column reports the result.
+ */
+void sparse_benchmark(int n, double density)
+{
+    matrix_t matrix1 = matrix_create(n, n, ROW_MAJOR, use_huge_pages);
+    matrix_t matrix2 = matrix_create(n, n, ROW_MAJOR, use_huge_pages);
+    matrix_t result = matrix_create(n, n, ROW_MAJOR, use_huge_pages);
+    matrix_fill_sparse(&matrix1, 1, density);
+    matrix_fill_sparse(&matrix2, 2, density);
+
+    sparse_t csr1 = sparse_from_dense(&matrix1, ROW_MAJOR);
+    sparse_t csr2 = sparse_from_dense(&matrix2, ROW_MAJOR);
+    sparse_t csc1 = sparse_from_dense(&matrix1, COL_MAJOR);
+
+    int *x = malloc(n * sizeof(int)), *y = malloc(n * sizeof(int)), *y_ref = NULL;
+    for (int j = 0; j < n; j++)
+        x[j] = random_value(matrix_seed, 3, 0, j);
+
+    long bad = 0;
+    if (verify_results)
+    {
+        y_ref = malloc(n * sizeof(int));
+        for (int i = 0; i < n; i++)
+        {
+            int sum = 0;
+            for (int j = 0; j < n; j++)
+                sum += MAT(&matrix1, i, j) * x[j];
+            y_ref[i] = sum;
+        }
+    }
+
+    double times[5], start_time = omp_get_wtime();
+    multiply_blocked(n, &matrix1, &matrix2, &result);
+    times[0] = omp_get_wtime() - start_time;
+
+    start_time = omp_get_wtime();
+    sparse_t product = sparse_multiply(&csr1, &csr2);
+    times[1] = omp_get_wtime() - start_time;
+    if (verify_results)
+    {
+        long bad_dense = freivalds_check(&matrix1, &matrix2, &result, FREIVALDS_TRIALS);
+        long bad_sparse = sparse_mismatches(&product, &result);
+        if (bad_dense > 0 || bad_sparse > 0)
+            fprintf(stderr, "Error: sparse %d, density %g: %ld blocked rows fail Freivalds, %ld SpGEMM rows differ from blocked\n",
+                    n, density, bad_dense, bad_sparse);
+        bad += bad_dense + bad_sparse;
+    }
+    sparse_free(&product);
 
-    // Free dynamically allocated memory to prevent memory leaks
-    for (i = 0; i < rows; i++)
+    // The matrix-vector kernels each run on a poisoned y and are compared with y_ref
+    const char *mv_names[3] = { "dense MV", "SpMV csr", "SpMV csc" };
+    for (int k = 0; k < 3; k++)
     {
-        free(matrix1[i]);
-        free(matrix2[i]);
-        free(result[i]);
+        if (verify_results)
+            memset(y, 0xff, n * sizeof(int));
+
+        start_time = omp_get_wtime();
+        for (int r = 0; r < MV_REPEATS; r++)
+        {
+            if (k == 0)
+                multiply_dense_mv(&matrix1, x, y);
+            else
+                sparse_mv(k == 1 ? &csr1 : &csc1, x, y);
+        }
+        times[2 + k] = (omp_get_wtime() - start_time) / MV_REPEATS;
+
+        if (verify_results)
+        {
+            long bad_mv = vector_mismatches(y, y_ref, n);
+            if (bad_mv > 0)
+                fprintf(stderr, "Error: %s %d, density %g: %ld elements differ from the serial product\n",
+                        mv_names[k], n, density, bad_mv);
+            bad += bad_mv;
+        }
     }
-    free(matrix1);
-    free(matrix2);
-    free(result);
+
+    printf("| %10g | %10d | %10.1f | %10.6f | %10.6f | %10.6f | %10.6f | %10.6f |", density, n,
+           (double)csr1.nnz / n, times[0], times[1], times[2], times[3], times[4]);
+    if (verify_results)
+        printf(" %10s |\n", bad ? "FAILED" : "ok");
+    else
+        printf("\n");
+    verify_failures += bad > 0;
+
+    free(x);
+    free(y);
+    free(y_ref);
+    sparse_free(&csr1);
+    sparse_free(&csr2);
+    sparse_free(&csc1);
+    matrix_free(&matrix1);
+    matrix_free(&matrix2);
+    matrix_free(&result);
 }
@@ -0,0 +1,369 @@
+// Distributed Matrix Multiplication using MPI + OpenMP (SUMMA)
+//
+// The matrices are split into blocks on a 2D process grid. For every panel of k,
+// the ranks owning that slice of matrix1 broadcast it along their grid row and the
+// ranks owning that slice of matrix2 broadcast it along their grid column; every
+// rank then multiplies the two panels into its block of the result with the
+// node-local OpenMP blocked kernel from Matrix_Multiply.c.
+//
+// Broadcasts are non-blocking (MPI_Ibcast): the panels for step s+1 are in flight
+// while step s is being multiplied. Open MPI only progresses a non-blocking collective
+// inside MPI calls, so the multiply runs in row pieces with MPI_Testall between them.
+//
+// Every run checks its result block with Freivalds' test against elements regenerated
+// from the counter-based generator (not timed).
+//
+// Compilation Command:
+//   mpicc -O3 -fopenmp -o matrix_mpi Matrix_Multiply_MPI.c -lm
+//
+// Run (one Linux box is fine; OMP_NUM_THREADS sets threads per rank):
+//   mpirun -np 4 ./matrix_mpi [strong_n] [weak_n]
+//
+#define MATRIX_MULTIPLY_NO_MAIN
+#include "Matrix_Multiply.c"
+
+#include <math.h>
+#include <mpi.h>
+
+#define ROOT 0            // Rank that prints the tables
+#define SUMMA_PANEL 256   // Maximum width of a broadcast panel (matches GEMM_KC)
+#define SUMMA_PIECES 8    // Row pieces per panel multiply; MPI_Testall between pieces drives the next broadcasts
+
+// First global index owned by block b of p when n is split as evenly as possible
+static int block_lo(int b, int p, int n)
+{
+    return (int)((long)b * n / p);
+}
+
+// int32 matrix over a contiguous caller-owned buffer (leading dimension = cols)
+static matrix_t panel_matrix(int *buf, int rows, int cols)
+{
+    matrix_t m;
+    m.rows = rows;
+    m.cols = cols;
+    m.ld = cols;
+    m.layout = ROW_MAJOR;
+    m.type = ELEM_I32;
+    m.esz = sizeof(int);
+    m.rs = cols;
+    m.cs = 1;
+    m.data = buf;
+    return m;
+}
+
+// Block of p that owns global index k
+static int block_owner(int k, int p, int n)
+{
+    int b = 0;
+    while (block_lo(b + 1, p, n) <= k)
+        b++;
+    return b;
+}
+
+/**
+ * Per-rank SUMMA state: grid position, local blocks of matrix1 and matrix2,
+ * and the two panel buffers used for double buffering.
+ */
+typedef struct
+{
+    int n, pr, pc, r, c;
+    int mloc, nloc;      // Local block of the result
+    int a_k0, b_k0;      // First global k of the local blocks of matrix1 and matrix2
+    matrix_t a, b;
+    MPI_Comm row_comm, col_comm;
+    int *a_buf[2], *b_buf[2];
+    MPI_Request req[2][2];
+} summa_t;
+
+/**
+ * Posts the broadcasts of the panel that starts at global index k0 into buffer `slot`.
+ * Panels are cut at block boundaries of both matrix1's columns and matrix2's rows, so each
+ * panel has exactly one owner per grid row (for matrix1) and per grid column (for matrix2).
+ *
+ * Returns the panel width.
+ */
+static int summa_post_panel(summa_t *s, int k0, int slot)
+{
+    int owner_c = block_owner(k0, s->pc, s->n), owner_r = block_owner(k0, s->pr, s->n);
+    int end = k0 + SUMMA_PANEL;
+    if (end > block_lo(owner_c + 1, s->pc, s->n))
+        end = block_lo(owner_c + 1, s->pc, s->n);
+    if (end > block_lo(owner_r + 1, s->pr, s->n))
+        end = block_lo(owner_r + 1, s->pr, s->n);
+    int w = end - k0;
+
+    if (s->c == owner_c)
+    {
+        for (int i = 0; i < s->mloc; i++)
+            memcpy(&s->a_buf[slot][(size_t)i * w], &MAT(&s->a, i, k0 - s->a_k0), w * sizeof(int));
+    }
+    if (s->r == owner_r)
+    {
+        for (int k = 0; k < w; k++)
+            memcpy(&s->b_buf[slot][(size_t)k * s->nloc], &MAT(&s->b, k0 - s->b_k0 + k, 0), s->nloc * sizeof(int));
+    }
+
+    MPI_Ibcast(s->a_buf[slot], s->mloc * w, MPI_INT, owner_c, s->row_comm, &s->req[slot][0]);
+    MPI_Ibcast(s->b_buf[slot], w * s->nloc, MPI_INT, owner_r, s->col_comm, &s->req[slot][1]);
+    return w;
+}
+
+/**
+ * Freivalds' test of this rank's block of the result. For rows i and columns j of the
+ * block and a random vector r over those columns, sum_j C(i, j) r_j must equal
+ * sum_k A(i, k) (sum_j B(k, j) r_j); the full rows of A and columns of B are
+ * regenerated from random_value(), so no other rank's data is needed. Arithmetic is
+ * modulo 2^64, as in freivalds_check().
+ *
+ * Returns the number of mismatching rows of this rank over all trials.
+ */
+static long summa_verify(const summa_t *s, const matrix_t *result, int row0, int col0, int trials)
+{
+    uint64_t *r = malloc((s->nloc + 1) * sizeof(uint64_t));
+    uint64_t *br = malloc(s->n * sizeof(uint64_t));
+    long bad = 0;
+
+    for (int trial = 0; trial < trials; trial++)
+    {
+        for (int j = 0; j < s->nloc; j++)
+            r[j] = random_bits(matrix_seed, FREIVALDS_STREAM, trial, col0 + j);
+
+        #pragma omp parallel for schedule(static)
+        for (int k = 0; k < s->n; k++)
+        {
+            uint64_t sum = 0;
+            for (int j = 0; j < s->nloc; j++)
+                sum += (uint64_t)random_value(matrix_seed, 2, k, col0 + j) * r[j];
+            br[k] = sum;
+        }
+
+        #pragma omp parallel for schedule(static) reduction(+ : bad)
+        for (int i = 0; i < s->mloc; i++)
+        {
+            uint64_t abr = 0, cr = 0;
+            for (int k = 0; k < s->n; k++)
+                abr += (uint64_t)random_value(matrix_seed, 1, row0 + i, k) * br[k];
+            for (int j = 0; j < s->nloc; j++)
+                cr += (uint64_t)(int64_t)MAT(result, i, j) * r[j];
+            bad += abr != cr;
+        }
+    }
+
+    free(r);
+    free(br);
+    return bad;
+}
+
+/**
+ * Multiplies two n x n matrices with SUMMA on the ranks of `comm` and returns the
+ * elapsed time of the slowest rank (valid on rank 0 of comm).
+ *
+ * @param comm: Communicator of the participating ranks.
+ * @param n: Dimension of the global matrices.
+ * @param grid: Filled with the process grid dimensions.
+ * @param bad_rows: Receives the mismatching rows of the Freivalds check summed over all ranks.
+ */
+static double summa_run(MPI_Comm comm, int n, int grid[2], long *bad_rows)
+{
+    int size, cart_rank, periods[2] = { 0, 0 }, coords[2];
+    MPI_Comm cart;
+    summa_t s;
+
+    MPI_Comm_size(comm, &size);
+    grid[0] = grid[1] = 0;
+    MPI_Dims_create(size, 2, grid);
+    MPI_Cart_create(comm, 2, grid, periods, 0, &cart);
+    MPI_Comm_rank(cart, &cart_rank);
+    MPI_Cart_coords(cart, cart_rank, 2, coords);
+
+    // row_comm: ranks in my grid row, ordered by column; col_comm: my grid column, ordered by row
+    int keep_cols[2] = { 0, 1 }, keep_rows[2] = { 1, 0 };
+    MPI_Cart_sub(cart, keep_cols, &s.row_comm);
+    MPI_Cart_sub(cart, keep_rows, &s.col_comm);
+
+    s.n = n;
+    s.pr = grid[0];
+    s.pc = grid[1];
+    s.r = coords[0];
+    s.c = coords[1];
+
+    // result is split by (grid row, grid column) over (i, j), matrix1 over (i, k), matrix2 over (k, j)
+    int row0 = block_lo(s.r, s.pr, n), col0 = block_lo(s.c, s.pc, n);
+    s.mloc = block_lo(s.r + 1, s.pr, n) - row0;
+    s.nloc = block_lo(s.c + 1, s.pc, n) - col0;
+    s.a_k0 = col0;
+    s.b_k0 = row0;
+    int a_kloc = s.nloc, b_kloc = s.mloc;
+
+    s.a = matrix_create(s.mloc, a_kloc, ROW_MAJOR, use_huge_pages);
+    s.b = matrix_create(b_kloc, s.nloc, ROW_MAJOR, use_huge_pages);
+    matrix_t result = matrix_create(s.mloc, s.nloc, ROW_MAJOR, use_huge_pages);
+
+    // Elements come from the counter-based generator keyed by their global position,
+    // so every decomposition multiplies the same matrices
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < s.mloc; i++)
+        for (int k = 0; k < a_kloc; k++)
+            MAT(&s.a, i, k) = random_value(matrix_seed, 1, row0 + i, s.a_k0 + k);
+
+    #pragma omp parallel for schedule(static)
+    for (int k = 0; k < b_kloc; k++)
+        for (int j = 0; j < s.nloc; j++)
+            MAT(&s.b, k, j) = random_value(matrix_seed, 2, s.b_k0 + k, col0 + j);
+
+    for (int t = 0; t < 2; t++)
+    {
+        s.a_buf[t] = malloc(((size_t)s.mloc * SUMMA_PANEL + 1) * sizeof(int));
+        s.b_buf[t] = malloc(((size_t)s.nloc * SUMMA_PANEL + 1) * sizeof(int));
+    }
+
+    MPI_Barrier(comm);
+    double start = MPI_Wtime();
+
+    // Step `step` multiplies the panels in buffer step % 2 while the broadcasts
+    // for step + 1 are already posted into the other buffer
+    int step = 0, k0 = 0;
+    int w = summa_post_panel(&s, 0, 0);
+    while (k0 < n)
+    {
+        int slot = step % 2, next_w = 0;
+        if (k0 + w < n)
+            next_w = summa_post_panel(&s, k0 + w, 1 - slot);
+
+        MPI_Waitall(2, s.req[slot], MPI_STATUSES_IGNORE);
+
+        // result += A panel (mloc x w) * B panel (w x nloc); the first panel overwrites.
+        // Row pieces of whole GEMM_MC blocks; each piece repacks the B panel (w x nloc),
+        // which is 1 / piece of its multiply work
+        matrix_t ap = panel_matrix(s.a_buf[slot], s.mloc, w);
+        matrix_t bp = panel_matrix(s.b_buf[slot], w, s.nloc);
+        int piece = (s.mloc + SUMMA_PIECES - 1) / SUMMA_PIECES;
+        piece = (piece + GEMM_MC - 1) / GEMM_MC * GEMM_MC;
+        for (int i0 = 0; i0 < s.mloc && s.nloc > 0; i0 += piece)
+        {
+            int rows = (s.mloc - i0 < piece) ? s.mloc - i0 : piece;
+            matrix_t ap_rows = matrix_view(&ap, i0, 0, rows, w);
+            matrix_t result_rows = matrix_view(&result, i0, 0, rows, s.nloc);
+            multiply_blocked_isa(rows, s.nloc, w, &ap_rows, &bp, &result_rows, active_isa[ELEM_I32], step > 0);
+
+            if (next_w > 0)
+            {
+                int done;
+                MPI_Testall(2, s.req[1 - slot], &done, MPI_STATUSES_IGNORE);
+            }
+        }
+
+        k0 += w;
+        w = next_w;
+        step++;
+    }
+
+    double elapsed = MPI_Wtime() - start, max_elapsed;
+    MPI_Reduce(&elapsed, &max_elapsed, 1, MPI_DOUBLE, MPI_MAX, ROOT, comm);
+
+    long bad = summa_verify(&s, &result, row0, col0, FREIVALDS_TRIALS);
+    MPI_Reduce(&bad, bad_rows, 1, MPI_LONG, MPI_SUM, ROOT, comm);
+
+    for (int t = 0; t < 2; t++)
+    {
+        free(s.a_buf[t]);
+        free(s.b_buf[t]);
+    }
+    matrix_free(&s.a);
+    matrix_free(&s.b);
+    matrix_free(&result);
+    MPI_Comm_free(&s.row_comm);
+    MPI_Comm_free(&s.col_comm);
+    MPI_Comm_free(&cart);
+    return max_elapsed;
+}
+
+/**
+ * Runs SUMMA on the first p ranks of MPI_COMM_WORLD for every p in 1, 2, 4, ...
+ * (plus the full world size) and prints one table row per p.
+ *
+ * @param base_n: Matrix size for p = 1.
+ * @param weak: Non-zero to grow n with p so the work per rank (n^3 / p) stays constant.
+ * @return Number of runs whose result failed the Freivalds check (valid on ROOT).
+ */
+static int scaling_table(int base_n, int weak)
+{
+    int rank, world;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &world);
+
+    if (rank == ROOT)
+    {
+        printf("\n%s scaling (base N = %d, %d OpenMP threads per rank, %s %s micro-kernel)\n",
+               weak ? "Weak" : "Strong", base_n, omp_get_max_threads(),
+               elem_names[ELEM_I32], isa_names[active_isa[ELEM_I32]]);
+        printf("+------------+------------+------------+------------+------------+------------+------------+\n");
+        printf("| %10s | %10s | %10s | %10s | %10s | %10s | %10s |\n", "Procs", "Grid", "MatrixSize", "Time (s)", "GFLOP/s",
+               "Efficiency", "Freivalds");
+        printf("+------------+------------+------------+------------+------------+------------+------------+\n");
+    }
+
+    double t1 = 0;
+    int failures = 0;
+    for (int p = 1; p <= world; p = (p * 2 > world && p < world) ? world : p * 2)
+    {
+        int n = weak ? (int)lround(base_n * cbrt((double)p)) : base_n;
+        int grid[2];
+        MPI_Comm sub;
+        MPI_Comm_split(MPI_COMM_WORLD, rank < p ? 0 : MPI_UNDEFINED, rank, &sub);
+
+        double t = 0;
+        long bad_rows = 0;
+        if (sub != MPI_COMM_NULL)
+        {
+            t = summa_run(sub, n, grid, &bad_rows);
+            MPI_Comm_free(&sub);
+        }
+        MPI_Barrier(MPI_COMM_WORLD);
+
+        if (rank == ROOT)
+        {
+            if (p == 1)
+                t1 = t;
+            // Strong: T1 / (p * Tp); weak: T1 / Tp
+            double efficiency = weak ? t1 / t : t1 / (p * t);
+            char grid_str[16];
+            snprintf(grid_str, sizeof(grid_str), "%dx%d", grid[0], grid[1]);
+            printf("| %10d | %10s | %10d | %10.6f | %10.2f | %9.1f%% | %10s |\n",
+                   p, grid_str, n, t, 2.0 * n * n * (double)n / t * 1e-9, 100.0 * efficiency, bad_rows ? "FAILED" : "ok");
+            failures += bad_rows > 0;
+        }
+    }
+
+    if (rank == ROOT)
+        printf("+------------+------------+------------+------------+------------+------------+------------+\n");
+    return failures;
+}
+
+int main(int argc, char *argv[])
+{
+    // The OpenMP kernel runs between MPI calls made by the main thread only
+    int provided, rank;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    if (provided < MPI_THREAD_FUNNELED)
+    {
+        if (rank == ROOT)
+            fprintf(stderr, "Error: the MPI library grants thread level %d, but %s needs MPI_THREAD_FUNNELED\n", provided, argv[0]);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    int strong_n = argc > 1 ? atoi(argv[1]) : 1600;
+    int weak_n = argc > 2 ? atoi(argv[2]) : 800;
+
+    detect_isa();
+
+    int failures = scaling_table(strong_n, 0);
+    failures += scaling_table(weak_n, 1);
+
+    if (rank == ROOT && failures)
+        fprintf(stderr, "%d run(s) failed the Freivalds check\n", failures);
+
+    MPI_Finalize();
+    return (rank == ROOT && failures) ? 1 : 0;
+}
@@ -1,82 +1,263 @@
-#include <stdio.h>
-#include <stdlib.h>
+// Hybrid MPI + OpenMP Monte Carlo Estimation of PI
+//
+// Every rank counts its samples with the OpenMP Philox kernel of Monto_Carlo_OMP.c, on
+// OMP_NUM_THREADS threads (or the thread counts of the scaling matrix).
+//
+// Random streams:
+// - The samples of a run form one global Philox4x32-10 counter sequence, and each rank
+//   takes a contiguous range of counters. A counter-based generator jumps ahead for free
+//   (the state at sample i is just i), so ranks never overlap or correlate the way
+//   SEED + rank streams can.
+// - The estimate for a given seed is the same for every process and thread count.
+//
+// Convergence mode:
+// - Batches are combined with MPI_Iallreduce. The reduction of batch k is in flight
+//   while batch k + 1 is counted, and the stop test for batch k runs once it lands.
+//
+// Compilation Command:
+//   mpicc -O3 -fopenmp -o Monto_Carlo_MPI Monto_Carlo_MPI.c -lm
+//
+// Run (one Linux box is fine; --oversubscribe when ranks x threads exceed the cores):
+//   mpirun --oversubscribe -np 4 ./Monto_Carlo_MPI [n] [--seed=N]
+//   mpirun --oversubscribe -np 4 ./Monto_Carlo_MPI converge [--tol=1e-4] [--batch=1e8] [--max=1e12] [--seed=N]
+//
+#define MONTE_CARLO_NO_MAIN
+#include "Monto_Carlo_OMP.c"
+
 #include <mpi.h>
 
-#define SEED 3655942  // Seed for random number generation
-#define ROOT 0        // Define root process (rank 0) for collecting results
+#define ROOT 0        // Rank that prints the tables
+#define MC_PIECES 16  // Pieces per rank and batch; MPI_Test between pieces drives the pending reduction
 
-int main(int argc, char *argv[])
+/**
+ * Counts this rank's share of samples [first, first + n) of the global sequence (first
+ * even). Ranks take contiguous ranges of the n / 2 counters, and the last rank also
+ * takes the odd trailing sample.
+ *
+ * The range is counted in MC_PIECES pieces. Open MPI only progresses a non-blocking
+ * collective inside MPI calls, so `pending` (if any) is tested after each piece.
+ */
+static long rank_hits(long first, long n, int rank, int size, MPI_Request *pending)
 {
-    // Initialize MPI environment
-    MPI_Init(&argc, &argv);
+    long counters = n / 2;
+    long lo = counters * rank / size, hi = counters * (rank + 1) / size;
+    long len = 2 * (hi - lo) + (rank == size - 1 ? (n & 1) : 0);
+    long hits = 0;
+
+    for (int k = 0; k < MC_PIECES; k++)
+    {
+        long a = 2 * ((hi - lo) * k / MC_PIECES);
+        long b = (k == MC_PIECES - 1) ? len : 2 * ((hi - lo) * (k + 1) / MC_PIECES);
+        hits += count_hits(first + 2 * lo + a, b - a);
+
+        if (pending && *pending != MPI_REQUEST_NULL)
+        {
+            int done;
+            MPI_Test(pending, &done, MPI_STATUS_IGNORE);
+        }
+    }
+    return hits;
+}
+
+/**
+ * Counts n samples on the first p ranks of MPI_COMM_WORLD for every p in 1, 2, 4, ...
+ * (plus the full world size) and every thread count, and prints the time of each
+ * process x thread combination. The estimate column checks that all of them drew the
+ * same points.
+ */
+static void scaling_matrix(long n)
+{
+    int rank, world;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &world);
+
+    int num_threads[] = {1, 2, 4, 8};
+    int num_threads_size = sizeof(num_threads) / sizeof(num_threads[0]);
+    long first_hits = -1;
+    int same = 1;
+
+    if (rank == ROOT)
+    {
+        printf("\nScaling matrix for %ld samples (time in seconds)\n", n);
+        printf("+--------------+------------+------------+------------+------------+--------------+\n");
+        printf("| Procs \\ Thr  | Thread 1   | Thread 2   | Thread 4   | Thread 8   | Estimated PI |\n");
+        printf("+--------------+------------+------------+------------+------------+--------------+\n");
+    }
+
+    for (int p = 1; p <= world; p = (p * 2 > world && p < world) ? world : p * 2)
+    {
+        MPI_Comm sub;
+        MPI_Comm_split(MPI_COMM_WORLD, rank < p ? 0 : MPI_UNDEFINED, rank, &sub);
+
+        if (rank == ROOT)
+            printf("| %-12d", p);
+
+        for (int j = 0; j < num_threads_size; j++)
+        {
+            long hits = 0;
+            double time = 0;
+            if (sub != MPI_COMM_NULL)
+            {
+                int sub_rank;
+                MPI_Comm_rank(sub, &sub_rank);
+                omp_set_num_threads(num_threads[j]);
+
+                MPI_Barrier(sub);
+                double start = MPI_Wtime();
+                long local = rank_hits(0, n, sub_rank, p, NULL);
+                double elapsed = MPI_Wtime() - start;
+
+                MPI_Reduce(&local, &hits, 1, MPI_LONG, MPI_SUM, ROOT, sub);
+                MPI_Reduce(&elapsed, &time, 1, MPI_DOUBLE, MPI_MAX, ROOT, sub);
+            }
+
+            if (rank == ROOT)
+            {
+                if (first_hits < 0)
+                    first_hits = hits;
+                same &= hits == first_hits;
+                printf(" | %-9.6fs", time);
+                fflush(stdout);
+            }
+        }
 
+        if (sub != MPI_COMM_NULL)
+            MPI_Comm_free(&sub);
+        MPI_Barrier(MPI_COMM_WORLD);
+
+        // The estimate must not depend on the process or thread count
+        if (rank == ROOT)
+        {
+            if (same)
+                printf(" | %-12.8f |\n", (double)first_hits / n * 4);
+            else
+                printf(" | %-12s |\n", "MISMATCH");
+        }
+    }
+
+    if (rank == ROOT)
+        printf("+--------------+------------+------------+------------+------------+--------------+\n");
+}
+
+/**
+ * Long-running estimation over all ranks and threads: batches of consecutive samples
+ * until the 95% confidence interval is within +-tol, or max_samples.
+ *
+ * The hit count of each batch is reduced with MPI_Iallreduce while the next batch is
+ * counted (two send/receive slots), and every rank applies the stop test to the same
+ * reduced totals. The batch counted while the last reduction was in flight is kept,
+ * so a run can end up to one batch past the target.
+ */
+static void converge_hybrid(long batch, double tol, long max_samples)
+{
     int rank, size;
-    
-    // Get the rank (ID) of the current process
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
-    
-    // Get the total number of processes
     MPI_Comm_size(MPI_COMM_WORLD, &size);
+    int threads = omp_get_max_threads();
 
-    // Number of random points for Monte Carlo simulation
-    int n = 100000; 
-
-    double t; // Variable to store execution time
+    long send[2], recv[2], lens[2];
+    double times[2];  // Time this rank spent counting the batch in each slot
+    long hits = 0, samples = 0, sent = 0;
+    int slot = 0, in_flight = 0, b = 0;
+    double start = MPI_Wtime(), half_width = INFINITY;
+    MPI_Request req = MPI_REQUEST_NULL;
+    batch += batch & 1;
 
-    // Start the timer in the root process
     if (rank == ROOT)
     {
-        t = MPI_Wtime();
+        printf("Target: 95%% confidence interval within +-%g, batches of %ld, at most %ld samples, %d processes x %d threads\n\n",
+               tol, batch, max_samples, size, threads);
+        printf("+-------+----------------+--------------+------------+------------+------------+------------------+\n");
+        printf("| Batch | Samples        | Estimate     | Std Error  | 95%% CI +-  | |PI - Est| | Msamples/s/thr   |\n");
+        printf("+-------+----------------+--------------+------------+------------+------------+------------------+\n");
     }
 
-    int count = 0;      // Local count of points inside the circle
-    int red_count = 0;  // Reduced count (sum of counts from all processes)
+    for (;;)
+    {
+        // Count the next batch while the previous one is being reduced
+        int more = sent < max_samples && half_width > tol;
+        if (more)
+        {
+            lens[slot] = (max_samples - sent < batch) ? max_samples - sent : batch;
+            double batch_start = MPI_Wtime();
+            send[slot] = rank_hits(sent, lens[slot], rank, size, &req);
+            times[slot] = MPI_Wtime() - batch_start;
+            sent += lens[slot];
+        }
 
-    // Set a unique random seed for each process
-    srand(SEED + rank);
+        if (in_flight)
+        {
+            MPI_Wait(&req, MPI_STATUS_IGNORE);
+            hits += recv[1 - slot];
+            samples += lens[1 - slot];
+            in_flight = 0;
 
-    // Each process generates (n / size) random points
-    for (int i = 0; i < n / size; i++)
-    {
-        double x = (double)rand() / RAND_MAX; // Random x coordinate
-        double y = (double)rand() / RAND_MAX; // Random y coordinate
-        double z = x * x + y * y;            // Compute distance from origin
+            double p = (double)hits / samples, estimate = 4 * p;
+            double std_error = 4 * sqrt(p * (1 - p) / samples);
+            half_width = Z_95 * std_error;
+            if (rank == ROOT)
+            {
+                printf("| %5d | %-14ld | %-12.9f | %-10.3e | %-10.3e | %-10.3e | %-16.2f |\n", ++b, samples, estimate,
+                       std_error, half_width, fabs(M_PI - estimate), lens[1 - slot] / times[1 - slot] / (size * threads) * 1e-6);
+                fflush(stdout);
+            }
+        }
 
-        // If the point lies inside the unit circle, increase local count
-        if (z <= 1.0)
-            count++;
+        if (!more)
+            break;
+        MPI_Iallreduce(&send[slot], &recv[slot], 1, MPI_LONG, MPI_SUM, MPI_COMM_WORLD, &req);
+        in_flight = 1;
+        slot = 1 - slot;
     }
 
-    // Reduce all local counts to obtain the global count at the root process
-    MPI_Reduce(&count, &red_count, 1, MPI_INT, MPI_SUM, ROOT, MPI_COMM_WORLD);
-
-    /*
-     * MPI_Reduce Parameters:
-     * - &count:        Local count to send
-     * - &red_count:    Variable to store the reduced sum at the root
-     * - 1:            Number of elements to reduce
-     * - MPI_INT:      Data type of elements
-     * - MPI_SUM:      Reduction operation (sum of all counts)
-     * - ROOT:         Rank 0 collects the result
-     * - MPI_COMM_WORLD: MPI communicator (all processes)
-     */
-
-    // Root process calculates and prints the final result
     if (rank == ROOT)
     {
-        t = MPI_Wtime() - t; // Compute total execution time
+        printf("+-------+----------------+--------------+------------+------------+------------+------------------+\n");
+        printf("%s after %ld samples in %.3f s\n", half_width <= tol ? "Converged" : "Stopped at the sample limit",
+               samples, MPI_Wtime() - start);
+    }
+}
 
-        // Estimate the value of π using Monte Carlo formula
-        double pi = (double)red_count / n * 4;
+int main(int argc, char *argv[])
+{
+    // OpenMP regions run between MPI calls made by the main thread only
+    int provided, rank;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    if (provided < MPI_THREAD_FUNNELED)
+    {
+        if (rank == ROOT)
+            fprintf(stderr, "Error: the MPI library grants thread level %d, but %s needs MPI_THREAD_FUNNELED\n", provided, argv[0]);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
 
-        // Display results
-        printf("Time taken: %f seconds\n", t);
-        printf("Number of MPI processes: %d\n", size);
-        printf("Total number of trials: %d\n", n);
-        printf("Estimated value of Pi: %f\n", pi);
+    // converge [--tol=T] [--batch=B] [--max=M] runs batches until the interval is narrow enough
+    int converge = argc > 1 && strcmp(argv[1], "converge") == 0;
+    long n = 1000000000, batch = 100000000, max_samples = 1000000000000;
+    double tol = 1e-4;
+    for (int i = 1 + converge; i < argc; i++)
+    {
+        if (strncmp(argv[i], "--seed=", 7) == 0)
+            seed = strtoull(argv[i] + 7, NULL, 0);
+        else if (strncmp(argv[i], "--tol=", 6) == 0)
+            tol = strtod(argv[i] + 6, NULL);
+        else if (strncmp(argv[i], "--batch=", 8) == 0)
+            batch = (long)strtod(argv[i] + 8, NULL);
+        else if (strncmp(argv[i], "--max=", 6) == 0)
+            max_samples = (long)strtod(argv[i] + 6, NULL);
+        else
+            n = (long)strtod(argv[i], NULL);
     }
 
-    // Finalize the MPI environment
+    detect_isa();
+    if (rank == ROOT)
+        printf("\nPhilox4x32-10 sampling, seed %llu, %s kernel\n", (unsigned long long)seed, isa_names[active_isa]);
+
+    if (converge)
+        converge_hybrid(batch, tol, max_samples);
+    else
+        scaling_matrix(n);
+
     MPI_Finalize();
     return 0;
 }
@@ -10,116 +10,696 @@
 // 4. Count the points that fall inside the quarter circle using the condition: x² + y² ≤ 1.
 // 5. Use the formula: PI ≈ 4 * (points inside circle) / (total points).
 //
+// Random Numbers:
+// - Points come from Philox4x32-10, a counter-based generator: the bits of sample i are a
+//   function of (seed, i) only, so the estimate for a given seed does not depend on the
+//   number of threads or on which SIMD path ran.
+// - One Philox block (4 x 32 bits) gives two points with 31-bit coordinates. The hit test
+//   X² + Y² ≤ 2^62 is exact in 64-bit integers, so there is no branch and no rounding.
+//
 // Parallelization:
 // - The program uses OpenMP to parallelize the random point generation and counting process.
+// - Each thread counts whole blocks of counters with an AVX-512, AVX2 or generic kernel,
+//   chosen at startup from cpuid.
 // - Execution time is measured for different thread counts and input sizes.
 //
 // Compilation Command:
-//   gcc -fopenmp -o Monto_Carlo_OMP Monto_Carlo_OMP.c
+//   gcc -O3 -fopenmp -o Monto_Carlo_OMP Monto_Carlo_OMP.c -lm
+//
+// Run:
+//   ./Monto_Carlo_OMP [n] [--seed=N]      (n up to 1e11 and beyond, e.g. ./Monto_Carlo_OMP 1e11)
+//   ./Monto_Carlo_OMP converge [--tol=1e-4] [--batch=1e8] [--max=1e12] [--seed=N]
+//   ./Monto_Carlo_OMP [n] --sampler=philox|sobol|halton|stratified|latin
+//   ./Monto_Carlo_OMP compare [max_n]     (error vs time of every sampler)
 //
+#include <immintrin.h>
+#include <math.h>
 #include <omp.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #define SEED 35791246  // Seed value for random number generation
 
-// Function prototype
-void calculate_pi(int n, int num_threads[], int num_threads_size, int result);
+// Philox4x32-10 round multipliers and key increments (Salmon et al., Random123)
+#define PHILOX_M0 0xD2511F53u
+#define PHILOX_M1 0xCD9E8D57u
+#define PHILOX_W0 0x9E3779B9u
+#define PHILOX_W1 0xBB67AE85u
+#define PHILOX_ROUNDS 10
+
+#define MC_BLOCK (1L << 16)       // Philox counters per OpenMP work item (two samples each)
+#define CIRCLE_R2 (1ULL << 62)    // Squared radius of the quarter circle in 31-bit coordinates
+#define Z_95 1.959964             // Normal quantile of a two-sided 95% confidence interval
+
+// Sampling kernel instruction set paths, chosen at startup by detect_isa()
+enum { ISA_GENERIC, ISA_AVX2, ISA_AVX512, NUM_ISAS };
+static const char *isa_names[NUM_ISAS] = { "generic", "avx2", "avx512" };
+
+// Counts the hits of the two samples of every Philox counter in [first, first + count)
+typedef long (*hit_kernel_fn)(uint64_t first, uint64_t count, uint64_t seed);
+static hit_kernel_fn hit_kernel;
+static int active_isa = ISA_GENERIC;
+
+static uint64_t seed = SEED;
 
-int main()
+// Point sets: pseudo-random (Philox), quasi-random (Sobol, Halton) and stratified grids
+enum { SAMPLER_PHILOX, SAMPLER_SOBOL, SAMPLER_HALTON, SAMPLER_STRATIFIED, SAMPLER_LATIN, NUM_SAMPLERS };
+static const char *sampler_names[NUM_SAMPLERS] = { "philox", "sobol", "halton", "stratified", "latin" };
+static int sampler = SAMPLER_PHILOX;
+
+// Function prototypes
+void calculate_pi(long n, int num_threads[], int num_threads_size);
+void converge_pi(long batch, double tol, long max_samples);
+void compare_samplers(long max_n);
+
+static void detect_isa(void);
+
+#ifndef MONTE_CARLO_NO_MAIN
+int main(int argc, char *argv[])
 {
     // Different input sizes (number of points generated)
-    int niter[] = {10000, 100000, 1000000, 10000000};
+    long niter[] = {10000, 100000, 1000000, 10000000, 100000000, 1000000000};
+    int num_inputs = sizeof(niter) / sizeof(niter[0]);
 
     // Different numbers of OpenMP threads to be tested
     int num_threads[] = {1, 2, 4, 8};
-    
+
     // Determine the number of thread configurations
     int num_threads_size = sizeof(num_threads) / sizeof(num_threads[0]);
 
-    // Flag to control output format:
-    // result = 1 -> Print estimated PI values
-    // result = 0 -> Print only execution times
-    int result = 0;  
+    // ./Monto_Carlo_OMP converge runs batches until the confidence interval is narrow enough;
+    // ./Monto_Carlo_OMP compare prints the error and time of every sampler
+    int converge = argc > 1 && strcmp(argv[1], "converge") == 0;
+    int compare = argc > 1 && strcmp(argv[1], "compare") == 0;
+    long batch = 100000000, max_samples = 1000000000000;
+    double tol = 1e-4;
+
+    // An optional size replaces the list (e.g. 1e11); --seed=N selects another stream
+    for (int i = 1 + converge + compare; i < argc; i++)
+    {
+        if (strncmp(argv[i], "--seed=", 7) == 0)
+            seed = strtoull(argv[i] + 7, NULL, 0);
+        else if (strncmp(argv[i], "--sampler=", 10) == 0)
+        {
+            for (sampler = 0; sampler < NUM_SAMPLERS && strcmp(argv[i] + 10, sampler_names[sampler]) != 0; sampler++)
+                ;
+            if (sampler == NUM_SAMPLERS)
+            {
+                fprintf(stderr, "Unknown sampler %s (philox, sobol, halton, stratified, latin)\n", argv[i] + 10);
+                return 1;
+            }
+        }
+        else if (strncmp(argv[i], "--tol=", 6) == 0)
+            tol = strtod(argv[i] + 6, NULL);
+        else if (strncmp(argv[i], "--batch=", 8) == 0)
+            batch = (long)strtod(argv[i] + 8, NULL);
+        else if (strncmp(argv[i], "--max=", 6) == 0)
+            max_samples = (long)strtod(argv[i] + 6, NULL);
+        else
+        {
+            niter[0] = (long)strtod(argv[i], NULL);
+            num_inputs = 1;
+        }
+    }
+
+    detect_isa();
+
+    if (compare)
+    {
+        compare_samplers(num_inputs == 1 ? niter[0] : 100000000);
+        return 0;
+    }
+
+    if (converge)
+    {
+        // The standard error below assumes independent samples, which only Philox gives
+        printf("\nPhilox4x32-10 sampling, seed %llu, %s kernel\n", (unsigned long long)seed, isa_names[active_isa]);
+        converge_pi(batch, tol, max_samples);
+        return 0;
+    }
+
+    if (sampler == SAMPLER_PHILOX)
+        printf("\nPhilox4x32-10 sampling, seed %llu, %s kernel\n", (unsigned long long)seed, isa_names[active_isa]);
+    else
+        printf("\n%s sampling, seed %llu\n", sampler_names[sampler], (unsigned long long)seed);
 
     // Print table header with adjusted column sizes
-    printf("\n+--------------+------------+------------+------------+------------+\n");
-    printf("|  Input Size  | Thread 1   | Thread 2   | Thread 4   | Thread 8   |\n");
-    printf("+--------------+------------+------------+------------+------------+\n");
+    printf("\n+--------------+------------+------------+------------+------------+--------------+\n");
+    printf("|  Input Size  | Thread 1   | Thread 2   | Thread 4   | Thread 8   | Estimated PI |\n");
+    printf("+--------------+------------+------------+------------+------------+--------------+\n");
 
     // Run Monte Carlo simulation for each input size
-    for (int iter = 0; iter < sizeof(niter) / sizeof(niter[0]); iter++)
-        calculate_pi(niter[iter], num_threads, num_threads_size, result);
+    for (int iter = 0; iter < num_inputs; iter++)
+        calculate_pi(niter[iter], num_threads, num_threads_size);
 
     // Print table footer
-    printf("+--------------+------------+------------+------------+------------+\n");
+    printf("+--------------+------------+------------+------------+------------+--------------+\n");
 
     return 0;
 }
+#endif  // MONTE_CARLO_NO_MAIN
+
+/**
+ * Philox4x32-10 block for `counter` under key `seed`: ten rounds of two 32 x 32 -> 64-bit
+ * multiplies whose high halves are mixed with the other two words and the round key.
+ */
+static inline void philox4x32(uint64_t counter, uint64_t key, uint32_t out[4])
+{
+    uint32_t c0 = (uint32_t)counter, c1 = (uint32_t)(counter >> 32), c2 = 0, c3 = 0;
+    uint32_t k0 = (uint32_t)key, k1 = (uint32_t)(key >> 32);
+    for (int r = 0; r < PHILOX_ROUNDS; r++)
+    {
+        uint64_t p0 = (uint64_t)PHILOX_M0 * c0, p1 = (uint64_t)PHILOX_M1 * c2;
+        c0 = (uint32_t)(p1 >> 32) ^ c1 ^ k0;
+        c2 = (uint32_t)(p0 >> 32) ^ c3 ^ k1;
+        c1 = (uint32_t)p1;
+        c3 = (uint32_t)p0;
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+    out[0] = c0;
+    out[1] = c1;
+    out[2] = c2;
+    out[3] = c3;
+}
+
+// 1 if the point with coordinates (a >> 1, b >> 1) / 2^31 lies in the quarter circle
+static inline long in_circle(uint32_t a, uint32_t b)
+{
+    uint64_t x = a >> 1, y = b >> 1;
+    return x * x + y * y <= CIRCLE_R2;
+}
+
+static long hits_generic(uint64_t first, uint64_t count, uint64_t key)
+{
+    long hits = 0;
+    for (uint64_t j = first; j < first + count; j++)
+    {
+        uint32_t out[4];
+        philox4x32(j, key, out);
+        hits += in_circle(out[0], out[1]) + in_circle(out[2], out[3]);
+    }
+    return hits;
+}
+
+/*
+ * SIMD kernels keep one Philox word per 64-bit lane: mul_epu32 multiplies the low 32 bits
+ * of each lane into a full 64-bit product, so the high half is a shift away. Upper bits
+ * left over from the low halves are ignored by the next multiply and masked at the end.
+ */
+__attribute__((target("avx2")))
+static long hits_avx2(uint64_t first, uint64_t count, uint64_t key)
+{
+    const __m256i lo32 = _mm256_set1_epi64x(0xFFFFFFFF), r2 = _mm256_set1_epi64x(CIRCLE_R2 + 1);
+    const __m256i m0 = _mm256_set1_epi64x(PHILOX_M0), m1 = _mm256_set1_epi64x(PHILOX_M1);
+    __m256i acc = _mm256_setzero_si256();
+    uint64_t j = first, vec_end = first + count / 4 * 4;
+
+    for (; j < vec_end; j += 4)
+    {
+        __m256i ctr = _mm256_add_epi64(_mm256_set1_epi64x(j), _mm256_set_epi64x(3, 2, 1, 0));
+        __m256i c0 = _mm256_and_si256(ctr, lo32), c1 = _mm256_srli_epi64(ctr, 32);
+        __m256i c2 = _mm256_setzero_si256(), c3 = _mm256_setzero_si256();
+        uint32_t k0 = (uint32_t)key, k1 = (uint32_t)(key >> 32);
+        for (int r = 0; r < PHILOX_ROUNDS; r++)
+        {
+            __m256i p0 = _mm256_mul_epu32(c0, m0), p1 = _mm256_mul_epu32(c2, m1);
+            c0 = _mm256_xor_si256(_mm256_xor_si256(_mm256_srli_epi64(p1, 32), c1), _mm256_set1_epi64x(k0));
+            c2 = _mm256_xor_si256(_mm256_xor_si256(_mm256_srli_epi64(p0, 32), c3), _mm256_set1_epi64x(k1));
+            c1 = p1;
+            c3 = p0;
+            k0 += PHILOX_W0;
+            k1 += PHILOX_W1;
+        }
+
+        // x = word >> 1 (31 bits), hit when x0² + x1² <= 2^62 (cmpgt against 2^62 + 1)
+        __m256i x0 = _mm256_srli_epi64(_mm256_and_si256(c0, lo32), 1), y0 = _mm256_srli_epi64(_mm256_and_si256(c1, lo32), 1);
+        __m256i x1 = _mm256_srli_epi64(_mm256_and_si256(c2, lo32), 1), y1 = _mm256_srli_epi64(_mm256_and_si256(c3, lo32), 1);
+        __m256i d0 = _mm256_add_epi64(_mm256_mul_epu32(x0, x0), _mm256_mul_epu32(y0, y0));
+        __m256i d1 = _mm256_add_epi64(_mm256_mul_epu32(x1, x1), _mm256_mul_epu32(y1, y1));
+        acc = _mm256_sub_epi64(acc, _mm256_cmpgt_epi64(r2, d0));
+        acc = _mm256_sub_epi64(acc, _mm256_cmpgt_epi64(r2, d1));
+    }
+
+    uint64_t lanes[4];
+    _mm256_storeu_si256((__m256i *)lanes, acc);
+    return (long)(lanes[0] + lanes[1] + lanes[2] + lanes[3]) + hits_generic(j, first + count - j, key);
+}
+
+// AVX-512: eight counters per vector, three-way xor in one vpternlogq, hits from a compare mask
+__attribute__((target("avx512f")))
+static long hits_avx512(uint64_t first, uint64_t count, uint64_t key)
+{
+    const __m512i lo32 = _mm512_set1_epi64(0xFFFFFFFF), r2 = _mm512_set1_epi64(CIRCLE_R2);
+    const __m512i m0 = _mm512_set1_epi64(PHILOX_M0), m1 = _mm512_set1_epi64(PHILOX_M1);
+    const __m512i one = _mm512_set1_epi64(1);
+    __m512i acc = _mm512_setzero_si512();
+    uint64_t j = first, vec_end = first + count / 8 * 8;
+
+    for (; j < vec_end; j += 8)
+    {
+        __m512i ctr = _mm512_add_epi64(_mm512_set1_epi64(j), _mm512_set_epi64(7, 6, 5, 4, 3, 2, 1, 0));
+        __m512i c0 = _mm512_and_si512(ctr, lo32), c1 = _mm512_srli_epi64(ctr, 32);
+        __m512i c2 = _mm512_setzero_si512(), c3 = _mm512_setzero_si512();
+        uint32_t k0 = (uint32_t)key, k1 = (uint32_t)(key >> 32);
+        for (int r = 0; r < PHILOX_ROUNDS; r++)
+        {
+            __m512i p0 = _mm512_mul_epu32(c0, m0), p1 = _mm512_mul_epu32(c2, m1);
+            c0 = _mm512_ternarylogic_epi64(_mm512_srli_epi64(p1, 32), c1, _mm512_set1_epi64(k0), 0x96);
+            c2 = _mm512_ternarylogic_epi64(_mm512_srli_epi64(p0, 32), c3, _mm512_set1_epi64(k1), 0x96);
+            c1 = p1;
+            c3 = p0;
+            k0 += PHILOX_W0;
+            k1 += PHILOX_W1;
+        }
+
+        __m512i x0 = _mm512_srli_epi64(_mm512_and_si512(c0, lo32), 1), y0 = _mm512_srli_epi64(_mm512_and_si512(c1, lo32), 1);
+        __m512i x1 = _mm512_srli_epi64(_mm512_and_si512(c2, lo32), 1), y1 = _mm512_srli_epi64(_mm512_and_si512(c3, lo32), 1);
+        __m512i d0 = _mm512_add_epi64(_mm512_mul_epu32(x0, x0), _mm512_mul_epu32(y0, y0));
+        __m512i d1 = _mm512_add_epi64(_mm512_mul_epu32(x1, x1), _mm512_mul_epu32(y1, y1));
+        acc = _mm512_mask_add_epi64(acc, _mm512_cmple_epu64_mask(d0, r2), acc, one);
+        acc = _mm512_mask_add_epi64(acc, _mm512_cmple_epu64_mask(d1, r2), acc, one);
+    }
+
+    return (long)_mm512_reduce_add_epi64(acc) + hits_generic(j, first + count - j, key);
+}
+
+static const hit_kernel_fn hit_kernels[NUM_ISAS] = { hits_generic, hits_avx2, hits_avx512 };
+
+// Picks the widest sampling kernel the CPU (and OS) supports
+static void detect_isa(void)
+{
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        active_isa = ISA_AVX2;
+    if (__builtin_cpu_supports("avx512f"))
+        active_isa = ISA_AVX512;
+    hit_kernel = hit_kernels[active_isa];
+}
+
+/**
+ * Counts the points inside the quarter circle among samples [first, first + n) with the
+ * current number of OpenMP threads. `first` must be even, i.e. the start of a counter.
+ * Sample i is the first (i even) or second point of Philox counter i / 2, and the
+ * counters are dealt out in fixed blocks, so every thread count sees the same points.
+ */
+static long count_hits(long first, long n)
+{
+    long count = 0;  // Count of points inside the circle
+    long base = first / 2, counters = n / 2, blocks = (counters + MC_BLOCK - 1) / MC_BLOCK;
+
+    // Parallel region
+#pragma omp parallel
+    {
+        long local_count = 0;  // Local count for each thread
+
+#pragma omp for schedule(static)
+        for (long b = 0; b < blocks; b++)
+        {
+            long off = b * MC_BLOCK;
+            long len = (counters - off < MC_BLOCK) ? counters - off : MC_BLOCK;
+            local_count += hit_kernel(base + off, len, seed);
+        }
+
+        // Atomic update to avoid race conditions
+#pragma omp atomic
+        count += local_count;
+    }
+
+    // Odd n: the last sample is the first point of the next counter
+    if (n & 1)
+    {
+        uint32_t out[4];
+        philox4x32(base + counters, seed, out);
+        count += in_circle(out[0], out[1]);
+    }
+    return count;
+}
+
+/*
+ * Alternative point sets. Every sampler turns point i of an n-point set into two 32-bit
+ * coordinates (fractions of 2^32) that go through the same exact in_circle() test, and
+ * computes point i directly from i, so threads split [0, n) into blocks without overlap
+ * and get the same points for any thread count.
+ */
+
+#define QMC_MAX_POINTS 4294967295L  // Sobol, Halton and Latin index points with 32 bits
+
+// Philox key of a sampler's random jitter or scrambling, derived from the seed
+static uint64_t sampler_key(int s)
+{
+    return seed ^ (0x9E3779B97F4A7C15ULL * (uint64_t)(s + 1));
+}
+
+static uint32_t reverse_bits(uint32_t x)
+{
+    x = (x >> 16) | (x << 16);
+    x = ((x & 0xFF00FF00u) >> 8) | ((x & 0x00FF00FFu) << 8);
+    x = ((x & 0xF0F0F0F0u) >> 4) | ((x & 0x0F0F0F0Fu) << 4);
+    x = ((x & 0xCCCCCCCCu) >> 2) | ((x & 0x33333333u) << 2);
+    return ((x & 0xAAAAAAAAu) >> 1) | ((x & 0x55555555u) << 1);
+}
+
+/**
+ * Owen-style nested uniform scrambling of a 32-bit fraction (Burley 2020): a hash that
+ * only lets each bit depend on the bits above it (Laine-Karras), applied to the
+ * reversed bits. The scrambled set is still a (0, m, 2)-net, but randomized.
+ */
+static uint32_t nested_scramble(uint32_t x, uint32_t key)
+{
+    x = reverse_bits(x);
+    x += key;
+    x ^= x * 0x6C50B47Cu;
+    x ^= x * 0xB82F1E52u;
+    x ^= x * 0xC7AFE638u;
+    x ^= x * 0x8D22F6E6u;
+    return reverse_bits(x);
+}
+
+/**
+ * Scrambled 2D Sobol points of indices [first, first + count). Point i is the Sobol point
+ * of gray(i): the first point of a block is computed directly (skip-ahead: xor of the
+ * direction numbers of the set bits), each next one flips a single direction number.
+ * Dimension 1 is van der Corput; dimension 2 has primitive polynomial x + 1.
+ */
+static long hits_sobol(long first, long count, long n)
+{
+    (void)n;
+    uint32_t v1[32], v2[32], keys[4];
+    for (int k = 0; k < 32; k++)
+    {
+        v1[k] = 1u << (31 - k);
+        v2[k] = k ? v2[k - 1] ^ (v2[k - 1] >> 1) : 1u << 31;
+    }
+    philox4x32(0, sampler_key(SAMPLER_SOBOL), keys);
+
+    uint32_t gray = (uint32_t)(first ^ (first >> 1)), x = 0, y = 0;
+    for (int k = 0; k < 32; k++)
+    {
+        if (gray >> k & 1)
+        {
+            x ^= v1[k];
+            y ^= v2[k];
+        }
+    }
+
+    long hits = 0;
+    for (long i = first; i < first + count; i++)
+    {
+        hits += in_circle(nested_scramble(x, keys[0]), nested_scramble(y, keys[1]));
+        int k = __builtin_ctzl(i + 1);
+        x ^= v1[k];
+        y ^= v2[k];
+    }
+    return hits;
+}
+
+/**
+ * Halton points (bases 2 and 3) of indices [first, first + count). Base 2 is a bit
+ * reversal; the base-3 digits of the block's first index are computed directly and
+ * then counted up with carries.
+ */
+static long hits_halton(long first, long count, long n)
+{
+    (void)n;
+    int digits[21] = { 0 };   // 3^21 > 2^32
+    double weight[21], y = 0; // weight[k] = 3^-(k + 1)
+    weight[0] = 1.0 / 3;
+    for (int k = 1; k < 21; k++)
+        weight[k] = weight[k - 1] / 3;
+    for (long i = first, k = 0; i > 0; i /= 3, k++)
+    {
+        digits[k] = (int)(i % 3);
+        y += digits[k] * weight[k];
+    }
+
+    long hits = 0;
+    for (long i = first; i < first + count; i++)
+    {
+        hits += in_circle(reverse_bits((uint32_t)i), (uint32_t)(y * 4294967296.0));
+        int k = 0;
+        for (; digits[k] == 2; k++)
+        {
+            digits[k] = 0;
+            y -= 2 * weight[k];
+        }
+        digits[k]++;
+        y += weight[k];
+    }
+    return hits;
+}
+
+/**
+ * Jittered grid: an mx x my grid with mx = floor(sqrt n), one uniform point per cell
+ * (Philox jitter). The n - mx * my leftover points are plain uniform points, so the
+ * estimate stays unbiased for any n.
+ */
+static long hits_stratified(long first, long count, long n)
+{
+    uint64_t key = sampler_key(SAMPLER_STRATIFIED);
+    long mx = (long)sqrt((double)n);
+    while (mx * mx > n)
+        mx--;
+    while ((mx + 1) * (mx + 1) <= n)
+        mx++;
+    long my = n / mx, cells = mx * my;
+
+    long hits = 0;
+    for (long i = first; i < first + count; i++)
+    {
+        uint32_t out[4];
+        philox4x32(i, key, out);
+        if (i < cells)
+        {
+            uint64_t cx = i % mx, cy = i / mx;
+            out[0] = (uint32_t)(((cx << 32) + out[0]) / mx);
+            out[1] = (uint32_t)(((cy << 32) + out[1]) / my);
+        }
+        hits += in_circle(out[0], out[1]);
+    }
+    return hits;
+}
+
+/**
+ * Kensler's hash permutation of [0, len) ("Correlated Multi-Jittered Sampling"): a
+ * bijection on the next power of two, cycle-walked until it lands below len. It maps any
+ * index without building the permutation, so every thread can compute its own part.
+ */
+static uint32_t permute(uint32_t i, uint32_t len, uint32_t p)
+{
+    uint32_t w = len - 1;
+    w |= w >> 1;
+    w |= w >> 2;
+    w |= w >> 4;
+    w |= w >> 8;
+    w |= w >> 16;
+    do
+    {
+        i ^= p;
+        i *= 0xE170893Du;
+        i ^= p >> 16;
+        i ^= (i & w) >> 4;
+        i ^= p >> 8;
+        i *= 0x0929EB3Fu;
+        i ^= p >> 23;
+        i ^= (i & w) >> 1;
+        i *= 1 | p >> 27;
+        i *= 0x6935FA69u;
+        i ^= (i & w) >> 11;
+        i *= 0x74DCB303u;
+        i ^= (i & w) >> 2;
+        i *= 0x9E501CC3u;
+        i ^= (i & w) >> 2;
+        i *= 0xC860A3DFu;
+        i &= w;
+        i ^= i >> 5;
+    } while (i >= len);
+    return (i + p) % len;
+}
+
+// Latin hypercube: point i sits in column i and row permute(i) of an n x n grid, jittered
+static long hits_latin(long first, long count, long n)
+{
+    uint64_t key = sampler_key(SAMPLER_LATIN);
+    uint32_t perm_key = (uint32_t)(key >> 32);
+
+    long hits = 0;
+    for (long i = first; i < first + count; i++)
+    {
+        uint32_t out[4];
+        philox4x32(i, key, out);
+        uint64_t row = permute((uint32_t)i, (uint32_t)n, perm_key);
+        uint32_t x = (uint32_t)((((uint64_t)i << 32) + out[0]) / n);
+        uint32_t y = (uint32_t)(((row << 32) + out[1]) / n);
+        hits += in_circle(x, y);
+    }
+    return hits;
+}
+
+// Counts the hits among points [first, first + count) of an n-point set
+typedef long (*sampler_fn)(long first, long count, long n);
+static const sampler_fn sampler_kernels[NUM_SAMPLERS] = { NULL, hits_sobol, hits_halton, hits_stratified, hits_latin };
+
+/**
+ * Counts the hits of an n-point set of the given sampler with the current number of
+ * OpenMP threads; -1 if the sampler cannot index n points.
+ */
+static long count_points(int s, long n)
+{
+    if (s == SAMPLER_PHILOX)
+        return count_hits(0, n);
+    if (s != SAMPLER_STRATIFIED && n > QMC_MAX_POINTS)
+        return -1;
+
+    long count = 0, blocks = (n + MC_BLOCK - 1) / MC_BLOCK;
+#pragma omp parallel for schedule(static) reduction(+ : count)
+    for (long b = 0; b < blocks; b++)
+    {
+        long first = b * MC_BLOCK;
+        count += sampler_kernels[s](first, (n - first < MC_BLOCK) ? n - first : MC_BLOCK, n);
+    }
+    return count;
+}
 
 /**
  * Function: calculate_pi
  * -----------------------
  * Runs the Monte Carlo simulation to estimate PI using OpenMP parallelization.
- * 
+ *
  * @param n: Number of random points to generate
  * @param num_threads: Array containing different thread counts to test
  * @param num_threads_size: Number of thread configurations in num_threads[]
- * @param result: Flag (1 = Print estimated PI values, 0 = Print execution times)
  */
-void calculate_pi(int n, int num_threads[], int num_threads_size, int result)
+void calculate_pi(long n, int num_threads[], int num_threads_size)
 {
-    double pi_values[num_threads_size]; // Store estimated PI values
-    double times[num_threads_size];     // Store execution times
+    long counts[num_threads_size];  // Store points inside the circle
+    double times[num_threads_size]; // Store execution times
 
     for (int j = 0; j < num_threads_size; j++)
     {
-        int count = 0;  // Count of points inside the circle
-
         // Set the number of OpenMP threads
         omp_set_num_threads(num_threads[j]);
 
         // Start measuring execution time
         double start_time = omp_get_wtime();
 
-        // Parallel region
-#pragma omp parallel
-        {
-            int seed = SEED + omp_get_thread_num();  // Ensure unique seed per thread
-            int local_count = 0;  // Local count for each thread
-
-#pragma omp for
-            for (int i = 0; i < n; i++)
-            {
-                // Generate random (x, y) coordinates between 0 and 1
-                double x = (double)rand_r(&seed) / RAND_MAX;
-                double y = (double)rand_r(&seed) / RAND_MAX;
-
-                // Check if the point falls inside the quarter-circle
-                if (x * x + y * y <= 1)
-                    local_count++;
-            }
-
-            // Atomic update to avoid race conditions
-#pragma omp atomic
-            count += local_count;
-        }
-
-        // Compute estimated PI value
-        pi_values[j] = (double)count / n * 4;
+        counts[j] = count_points(sampler, n);
 
         // Compute elapsed time
         times[j] = omp_get_wtime() - start_time;
     }
 
     // Print results in table format with adjusted width
-    printf("| %-12d", n);
+    printf("| %-12ld", n);
     for (int j = 0; j < num_threads_size; j++)
+        printf(" | %-9.6fs", times[j]);    // Print execution time
+
+    // The estimate must not depend on the thread count
+    int same = 1;
+    for (int j = 1; j < num_threads_size; j++)
+        same &= counts[j] == counts[0];
+    if (counts[0] < 0)
+        printf(" | %-12s |\n", "-");
+    else if (same)
+        printf(" | %-12.8f |\n", (double)counts[0] / n * 4);
+    else
+        printf(" | %-12s |\n", "MISMATCH");
+}
+
+/**
+ * Function: converge_pi
+ * ----------------------
+ * Long-running estimation: draws batches of consecutive samples on all threads and
+ * prints the running estimate after each one. Every point is a Bernoulli trial with
+ * p = PI/4, so the estimate 4 * hits / N has standard error 4 * sqrt(p (1 - p) / N).
+ * Stops as soon as the 95% confidence interval is within +-tol, or at max_samples.
+ *
+ * @param batch: Samples per batch (rounded up to even)
+ * @param tol: Target half-width of the 95% confidence interval
+ * @param max_samples: Upper bound on the total number of samples
+ */
+void converge_pi(long batch, double tol, long max_samples)
+{
+    int threads = omp_get_max_threads();
+    long hits = 0, samples = 0;
+    double start = omp_get_wtime();
+    batch += batch & 1;
+
+    printf("Target: 95%% confidence interval within +-%g, batches of %ld, at most %ld samples, %d threads\n\n",
+           tol, batch, max_samples, threads);
+    printf("+-------+----------------+--------------+------------+------------+------------+------------------+\n");
+    printf("| Batch | Samples        | Estimate     | Std Error  | 95%% CI +-  | |PI - Est| | Msamples/s/thr   |\n");
+    printf("+-------+----------------+--------------+------------+------------+------------+------------------+\n");
+
+    double half_width = INFINITY;
+    for (int b = 1; samples < max_samples && half_width > tol; b++)
     {
-        if (result)
-            printf(" | %-10.6f", pi_values[j]);  // Print estimated PI value
-        else
-            printf(" | %-9.6fs", times[j]);    // Print execution time
+        long len = (max_samples - samples < batch) ? max_samples - samples : batch;
+        double batch_start = omp_get_wtime();
+        hits += count_hits(samples, len);
+        samples += len;
+        double batch_time = omp_get_wtime() - batch_start;
+
+        double p = (double)hits / samples, estimate = 4 * p;
+        double std_error = 4 * sqrt(p * (1 - p) / samples);
+        half_width = Z_95 * std_error;
+        printf("| %5d | %-14ld | %-12.9f | %-10.3e | %-10.3e | %-10.3e | %-16.2f |\n", b, samples, estimate,
+               std_error, half_width, fabs(M_PI - estimate), len / batch_time / threads * 1e-6);
+        fflush(stdout);
     }
-    printf(" |\n");
+
+    printf("+-------+----------------+--------------+------------+------------+------------+------------------+\n");
+    printf("%s after %ld samples in %.3f s\n", half_width <= tol ? "Converged" : "Stopped at the sample limit",
+           samples, omp_get_wtime() - start);
+}
+
+/**
+ * Function: compare_samplers
+ * ---------------------------
+ * Error vs time of every sampler for n = 1e3, 1e4, ... max_n on all threads: each cell is
+ * |PI - estimate| and the time it took, so the cheapest sampler for a target accuracy can
+ * be read off a column. Pseudo-random error shrinks as 1/sqrt(n); Sobol and Halton
+ * approach 1/n, and the jittered grid n^(-3/4) (only cells on the circle contribute).
+ *
+ * @param max_n: Largest number of points
+ */
+void compare_samplers(long max_n)
+{
+    printf("\nError vs time, seed %llu, %d threads (|PI - estimate| and seconds)\n\n",
+           (unsigned long long)seed, omp_get_max_threads());
+
+    printf("+--------------+");
+    for (int s = 0; s < NUM_SAMPLERS; s++)
+        printf("--------------------------+");
+    printf("\n|  Input Size  |");
+    for (int s = 0; s < NUM_SAMPLERS; s++)
+        printf(" %-24s |", sampler_names[s]);
+    printf("\n+--------------+");
+    for (int s = 0; s < NUM_SAMPLERS; s++)
+        printf("--------------------------+");
+    printf("\n");
+
+    for (long n = 1000; n <= max_n; n *= 10)
+    {
+        printf("| %-12ld |", n);
+        for (int s = 0; s < NUM_SAMPLERS; s++)
+        {
+            double start = omp_get_wtime();
+            long count = count_points(s, n);
+            double time = omp_get_wtime() - start;
+            if (count < 0)
+                printf(" %-24s |", "-");
+            else
+                printf(" %9.2e (%9.6f s)  |", fabs(M_PI - (double)count / n * 4), time);
+            fflush(stdout);
+        }
+        printf("\n");
+    }
+
+    printf("+--------------+");
+    for (int s = 0; s < NUM_SAMPLERS; s++)
+        printf("--------------------------+");
+    printf("\n");
 }
@@ -2,17 +2,37 @@
 #include <stdlib.h>
 #include <omp.h>
 #include <math.h>
+#include <sched.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <string.h>
+#include <unistd.h>
+
+// Inputs above this size only run the wheel sieve: the byte-per-number sieves
+// would need n bytes of memory for the cache-unfriendly version
+#define BYTE_SIEVE_MAX 1000000000L
+
+// Inputs above this size only run the bucket sieve
+#define WHEEL_SIEVE_MAX 10000000000L
+
+// Residues modulo 30 that are coprime to 2, 3 and 5. Bit b of byte k of a wheel
+// segment stands for the number 30k + wheel30[b]; no other number is stored.
+static const int wheel30[8] = { 1, 7, 11, 13, 17, 19, 23, 29 };
+
+// Bit of each residue modulo 30 (-1 for residues sharing a factor with 30)
+static const int8_t wheel_bit[30] = { -1, 0, -1, -1, -1, -1, -1, 1, -1, -1, -1, 2, -1, 3, -1,
+                                      -1, -1, 4, -1, 5, -1, -1, -1, 6, -1, -1, -1, -1, -1, 7 };
 
 // Helper function to mark multiples of a number as composite (not prime)
+// Returns the first multiple past `limit`, where marking continues in the next window
 static inline long mark(bool composite[], long i, long step, long limit)
 {
-    for (long j = i; j <= limit; j += step)
+    long j;
+    for (j = i; j <= limit; j += step)
     {
         composite[j] = true;
     }
-    return i;
+    return j;
 }
 
 // Cache Unfriendly Sieve of Eratosthenes (Basic Implementation)
@@ -170,41 +190,1031 @@ long parallel_sieve(long n)
     return count;
 }
 
-int main()
+// All primes up to limit with a plain byte sieve (limit is about sqrt(n), so this is small)
+static long *sieving_primes(long limit, long *count)
+{
+    bool *composite = calloc(limit + 1, sizeof(bool));
+    long *primes = malloc((limit + 1) * sizeof(long));
+    *count = 0;
+    for (long i = 2; i <= limit; i++)
+    {
+        if (!composite[i])
+        {
+            primes[(*count)++] = i;
+            if (i * i <= limit)
+                mark(composite, i * i, i, limit);
+        }
+    }
+    free(composite);
+    return primes;
+}
+
+// Wheel segment size in bytes (30 numbers per byte): a quarter of the L2 cache,
+// so the segment stays cached while every sieving prime sweeps over it
+static long wheel_segment_bytes(void)
 {
-    long input[3] = {1000000, 10000000, 100000000};
+    long l2 = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    long bytes = (l2 > 0) ? l2 / 4 : 128 * 1024;
+    if (bytes < 32 * 1024)
+        bytes = 32 * 1024;
+    if (bytes > 1024 * 1024)
+        bytes = 1024 * 1024;
+    return bytes;
+}
 
-    printf("\nSieve of Eratosthenes - Prime Number Counting\n");
-    printf("============================================\n\n");
+// Smallest multiple p*m with m >= m0 and m = wheel30[b] (mod 30)
+static inline long wheel_multiple(long p, long m0, int b)
+{
+    return p * (m0 + (wheel30[b] - m0 % 30 + 30) % 30);
+}
+
+/**
+ * Crosses the multiples of prime p (p >= 7) off the wheel segment that holds bytes
+ * [lo, lo + len). Multiples p*m with m coprime to 30 fall into eight residue classes;
+ * in each class p*m, p*(m + 30), ... keep the same bit and lie exactly p bytes apart.
+ * Crossing off starts at p*p.
+ */
+static void wheel_cross_off(uint8_t *segment, long lo, long len, long p)
+{
+    long m0 = (30 * lo + p - 1) / p;  // Smallest multiplier that reaches the segment
+    if (m0 < p)
+        m0 = p;
+
+    for (int b = 0; b < 8; b++)
+    {
+        long x = wheel_multiple(p, m0, b);
+        uint8_t keep = (uint8_t)~(1u << wheel_bit[x % 30]);
+        for (long k = x / 30 - lo; k < len; k += p)
+            segment[k] &= keep;
+    }
+}
+
+// Number of set bits in the first len bytes, 64 bits per popcount
+static long wheel_popcount(const uint8_t *segment, long len)
+{
+    long count = 0, k = 0;
+    for (; k + 8 <= len; k += 8)
+    {
+        uint64_t word;
+        memcpy(&word, segment + k, sizeof(word));
+        count += __builtin_popcountll(word);
+    }
+    for (; k < len; k++)
+        count += __builtin_popcount(segment[k]);
+    return count;
+}
+
+// Sets every bit of the wheel segment holding bytes [lo, lo + len) of [0, n], except
+// for 1 and the numbers above n in the last byte
+static void wheel_segment_init(uint8_t *segment, long lo, long len, long n)
+{
+    memset(segment, 0xff, len);
+    if (lo == 0)
+        segment[0] &= (uint8_t)~1u;  // 1 is not prime
+    if (lo + len > n / 30)
+    {
+        for (int b = 0; b < 8; b++)
+        {
+            if (wheel30[b] > n % 30)
+                segment[n / 30 - lo] &= (uint8_t)~(1u << b);
+        }
+    }
+}
+
+/**
+ * Sieves the wheel segment that holds bytes [lo, lo + len) of [0, n]: one bit per
+ * number coprime to 30, set while the number may be prime.
+ *
+ * @param primes: Sieving primes in increasing order (2, 3 and 5 are skipped).
+ */
+static void wheel_sieve_segment(uint8_t *segment, long lo, long len, long n, const long *primes, long n_primes)
+{
+    wheel_segment_init(segment, lo, len, n);
+
+    long end = 30 * (lo + len);
+    for (long i = 0; i < n_primes && primes[i] * primes[i] < end; i++)
+    {
+        if (primes[i] >= 7)
+            wheel_cross_off(segment, lo, len, primes[i]);
+    }
+}
+
+// Bit-packed Sieve of Eratosthenes on a mod-30 wheel (Parallelized Segmented Sieve)
+long wheel_sieve(long n)
+{
+    static const long small_counts[7] = { 0, 0, 1, 2, 2, 3, 3 };
+    if (n < 7)
+        return small_counts[n < 0 ? 0 : n];
+
+    long n_primes;
+    long *primes = sieving_primes((long)sqrt(n), &n_primes);
+    long bytes = n / 30 + 1, segment_bytes = wheel_segment_bytes();
+    long count = 3;  // 2, 3 and 5 are not on the wheel
+
+#pragma omp parallel
+    {
+        uint8_t *segment = malloc(segment_bytes);
+
+#pragma omp for schedule(dynamic) reduction(+ : count)
+        for (long lo = 0; lo < bytes; lo += segment_bytes)
+        {
+            long len = (bytes - lo < segment_bytes) ? bytes - lo : segment_bytes;
+            wheel_sieve_segment(segment, lo, len, n, primes, n_primes);
+            count += wheel_popcount(segment, len);
+        }
+
+        free(segment);
+    }
+
+    free(primes);
+    return count;
+}
+
+// Window of the byte-per-number engine: the L1 data cache (clamped to 16 KB - 256 KB);
+// crossing off small primes one byte at a time is fastest with the window in L1
+static long byte_window_size(void)
+{
+    long bytes = sysconf(_SC_LEVEL1_DCACHE_SIZE);
+    if (bytes <= 0)
+        bytes = 32 * 1024;
+    if (bytes < 16 * 1024)
+        bytes = 16 * 1024;
+    if (bytes > 256 * 1024)
+        bytes = 256 * 1024;
+    return bytes;
+}
+
+// Primes 2 ... PRESIEVE_LIMIT are crossed off by copying a precomputed pattern whose
+// period is their product (2*3*5*7*11*13*17 = 510510 bytes, which fits in L2)
+#define PRESIEVE_LIMIT 17
+#define PRESIEVE_PERIOD 510510L
+static const long presieve_primes[7] = { 2, 3, 5, 7, 11, 13, 17 };
+
+/**
+ * Segmented Sieve with per-thread arenas and incremental markers.
+ * The range is cut into contiguous chunks of windows, a few per thread. Each thread
+ * allocates one arena (window + markers) for the whole run instead of one buffer per
+ * window. A marker is set up with a division once per chunk (or when p*p enters the
+ * chunk) and then only moves forward: after marking a window it holds the offset of
+ * the next multiple in the following window.
+ *
+ * With `presieve`, a window starts as a copy of the pattern at phase w % PRESIEVE_PERIOD
+ * instead of all zeros, and marking starts with the first prime above PRESIEVE_LIMIT.
+ */
+static long arena_sieve_run(long n, int presieve)
+{
+    if (n < 2)
+        return 0;
+
+    long n_factor;
+    long *factor = sieving_primes((long)sqrt(n), &n_factor);
+    long window = byte_window_size();
+    long n_windows = n / window + 1;      // Windows cover [0, n]
+    long chunks = 4L * omp_get_max_threads();
+    if (chunks > n_windows)
+        chunks = n_windows;
+    long chunk_windows = (n_windows + chunks - 1) / chunks;
+    long count = 0;
+
+    // Pattern of the multiples of the presieved primes, one window longer than the period
+    // so every window is a single memcpy
+    bool *pattern = NULL;
+    long first_factor = 0;
+    if (presieve)
+    {
+        pattern = calloc(PRESIEVE_PERIOD + window, sizeof(bool));
+        for (int i = 0; i < 7; i++)
+            mark(pattern, 0, presieve_primes[i], PRESIEVE_PERIOD + window - 1);
+        while (first_factor < n_factor && factor[first_factor] <= PRESIEVE_LIMIT)
+            first_factor++;
+    }
+
+#pragma omp parallel reduction(+ : count)
+    {
+        size_t window_bytes = (window + 63) / 64 * 64;
+        size_t marker_bytes = ((n_factor + 1) * sizeof(long) + 63) / 64 * 64;
+        char *arena = aligned_alloc(64, window_bytes + marker_bytes);
+        bool *segment = (bool *)arena;
+        long *marker = (long *)(arena + window_bytes);
+
+#pragma omp for schedule(dynamic)
+        for (long c = 0; c < chunks; c++)
+        {
+            long lo = c * chunk_windows * window;
+            long hi = (lo + chunk_windows * window < n + 1) ? lo + chunk_windows * window : n + 1;
+
+            // Primes whose square lies before the chunk start continue at their first multiple in it
+            long n_active = 0;
+            for (; n_active < n_factor && factor[n_active] * factor[n_active] < lo; n_active++)
+            {
+                long p = factor[n_active];
+                marker[n_active] = (lo + p - 1) / p * p - lo;
+            }
+
+            for (long w = lo; w < hi; w += window)
+            {
+                long len = (hi - w < window) ? hi - w : window;
+                if (presieve)
+                    memcpy(segment, pattern + w % PRESIEVE_PERIOD, len);
+                else
+                    memset(segment, 0, len);
+                if (w == 0)
+                {
+                    segment[0] = segment[1] = true;  // 0 and 1 are not prime (len >= 3 as n >= 2)
+                    for (int i = 0; presieve && i < 7 && presieve_primes[i] < len; i++)
+                        segment[presieve_primes[i]] = false;  // The pattern marked the primes themselves
+                }
+
+                // Primes whose square falls into this window start marking there
+                for (; n_active < n_factor && factor[n_active] * factor[n_active] < w + len; n_active++)
+                    marker[n_active] = factor[n_active] * factor[n_active] - w;
+
+                for (long k = first_factor; k < n_active; k++)
+                    marker[k] = mark(segment, marker[k], factor[k], len - 1) - len;
+
+                for (long i = 0; i < len; i++)
+                    count += !segment[i];
+            }
+        }
+
+        free(arena);
+    }
+
+    free(pattern);
+    free(factor);
+    return count;
+}
+
+long arena_sieve(long n)
+{
+    return arena_sieve_run(n, 0);
+}
+
+// Arena engine whose windows start from the pre-sieved pattern of 2 ... 17
+long presieved_sieve(long n)
+{
+    return arena_sieve_run(n, 1);
+}
+
+/**
+ * Bucket entry of a large sieving prime: the next multiple of `prime` in one residue
+ * class, stored as the byte offset into the segment that owns the bucket (pos >> 3)
+ * and the bit of the class (pos & 7).
+ */
+typedef struct
+{
+    uint32_t prime;
+    uint32_t pos;
+} bucket_entry_t;
+
+// Growable list of entries; an emptied bucket keeps its capacity for reuse
+typedef struct
+{
+    bucket_entry_t *entries;
+    long size, capacity;
+} bucket_t;
+
+static void bucket_push(bucket_t *bucket, uint32_t prime, uint32_t pos)
+{
+    if (bucket->size == bucket->capacity)
+    {
+        bucket->capacity = bucket->capacity ? 2 * bucket->capacity : 1024;
+        bucket->entries = realloc(bucket->entries, bucket->capacity * sizeof(bucket_entry_t));
+    }
+    bucket->entries[bucket->size].prime = prime;
+    bucket->entries[bucket->size++].pos = pos;
+}
+
+// Bucket sieve segment size in bytes: a sixteenth of the L2 cache (clamped to 32 KB - 256 KB),
+// so the segment and the buckets being filled stay cached while the loop over the medium
+// primes is still spread over many hits per prime
+static long bucket_segment_bytes(void)
+{
+    long l2 = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    long bytes = (l2 > 0) ? l2 / 16 : 64 * 1024;
+    if (bytes < 32 * 1024)
+        bytes = 32 * 1024;
+    if (bytes > 256 * 1024)
+        bytes = 256 * 1024;
+    return bytes;
+}
+
+/**
+ * Counts the set bits of bytes [c_lo, c_hi) of the wheel bitset of [0, n] after
+ * sieving. Segments are sieved in order, so the state of every prime carries over
+ * from one segment to the next without divisions:
+ *   - medium primes (p < segment bytes) hit every segment; next[] holds the byte of
+ *     their next multiple in each residue class
+ *   - large primes hit a segment at most once per class, so each class is filed into
+ *     the bucket of the segment its next multiple falls in and is only touched there.
+ *     The buckets form a ring that covers the largest stride, (max p) / seg_bytes + 2
+ *     segments ahead.
+ */
+static long bucket_sieve_chunk(long c_lo, long c_hi, long n, const long *primes, long n_primes, long seg_bytes)
+{
+    long n_segs = (c_hi - c_lo + seg_bytes - 1) / seg_bytes;
+    long first = 0, mid, count = 0;
+    while (first < n_primes && primes[first] < 7)
+        first++;
+    for (mid = first; mid < n_primes && primes[mid] < seg_bytes; mid++)
+        ;
+
+    long ring = (n_primes > 0 ? primes[n_primes - 1] : 0) / seg_bytes + 2;
+    bucket_t *buckets = calloc(ring, sizeof(bucket_t));
+    long *next = malloc(((mid - first) * 8 + 1) * sizeof(long));
+    uint8_t *segment = malloc(seg_bytes);
+
+    for (long i = first; i < mid; i++)
+    {
+        long p = primes[i], m0 = (30 * c_lo + p - 1) / p;
+        if (m0 < p)
+            m0 = p;
+        for (int b = 0; b < 8; b++)
+            next[(i - first) * 8 + b] = wheel_multiple(p, m0, b) / 30;
+    }
 
-    printf("+---------------+----------------------------+----------------------------+----------------------------+\n");
-    printf("|   Input Size  |  Cache Unfriendly (sec)   |   Cache Friendly (sec)    |     Parallel (sec)        |\n");
-    printf("+---------------+----------------------------+----------------------------+----------------------------+\n");
+    long active = mid;  // Large primes below `active` have been filed
+    for (long s = 0; s < n_segs; s++)
+    {
+        long lo = c_lo + s * seg_bytes;
+        long len = (c_hi - lo < seg_bytes) ? c_hi - lo : seg_bytes;
+        long end = 30 * (lo + len);
+        wheel_segment_init(segment, lo, len, n);
+
+        for (long i = first; i < mid && primes[i] * primes[i] < end; i++)
+        {
+            long p = primes[i];
+            for (int b = 0; b < 8; b++)
+            {
+                long k = next[(i - first) * 8 + b];
+                uint8_t keep = (uint8_t)~(1u << wheel_bit[p * wheel30[b] % 30]);
+                for (; k < lo + len; k += p)
+                    segment[k - lo] &= keep;
+                next[(i - first) * 8 + b] = k;
+            }
+        }
+
+        // File the large primes whose square falls into this segment
+        for (; active < n_primes && primes[active] * primes[active] < end; active++)
+        {
+            long p = primes[active], m0 = (30 * lo + p - 1) / p;
+            if (m0 < p)
+                m0 = p;
+            for (int b = 0; b < 8; b++)
+            {
+                long x = wheel_multiple(p, m0, b), off = x / 30 - lo;
+                if (s + off / seg_bytes < n_segs)
+                    bucket_push(&buckets[(s + off / seg_bytes) % ring], p,
+                                (uint32_t)((off % seg_bytes) << 3 | wheel_bit[x % 30]));
+            }
+        }
+
+        // Cross off this segment's hits and move every entry on to its next segment
+        bucket_t *bucket = &buckets[s % ring];
+        for (long e = 0; e < bucket->size; e++)
+        {
+            long p = bucket->entries[e].prime, off = bucket->entries[e].pos >> 3;
+            int bit = bucket->entries[e].pos & 7;
+            if (off < len)
+                segment[off] &= (uint8_t)~(1u << bit);
+            off += p;
+            if (s + off / seg_bytes < n_segs)
+                bucket_push(&buckets[(s + off / seg_bytes) % ring], p, (uint32_t)((off % seg_bytes) << 3 | bit));
+        }
+        bucket->size = 0;
+
+        count += wheel_popcount(segment, len);
+    }
+
+    for (long r = 0; r < ring; r++)
+        free(buckets[r].entries);
+    free(buckets);
+    free(next);
+    free(segment);
+    return count;
+}
+
+/**
+ * Counts the primes on the wheel whose bytes lie in [b_lo, b_hi) of the bitset of
+ * [0, n], given the sieving primes up to sqrt(n). The range is cut into contiguous
+ * chunks of whole segments, a few per thread: each chunk sets up its prime state
+ * once and then sieves its segments in order.
+ */
+long bucket_count_range(long b_lo, long b_hi, long n, const long *primes, long n_primes)
+{
+    long seg_bytes = bucket_segment_bytes(), count = 0;
+    if (b_lo >= b_hi)
+        return 0;
+
+    long n_segs = (b_hi - b_lo + seg_bytes - 1) / seg_bytes;
+    long chunks = 4L * omp_get_max_threads();
+    if (chunks > n_segs)
+        chunks = n_segs;
+    long chunk_segs = (n_segs + chunks - 1) / chunks;
+
+#pragma omp parallel for schedule(dynamic) reduction(+ : count)
+    for (long c = 0; c < chunks; c++)
+    {
+        long c_lo = b_lo + c * chunk_segs * seg_bytes;
+        long c_hi = (c_lo + chunk_segs * seg_bytes < b_hi) ? c_lo + chunk_segs * seg_bytes : b_hi;
+        if (c_lo < c_hi)
+            count += bucket_sieve_chunk(c_lo, c_hi, n, primes, n_primes, seg_bytes);
+    }
+    return count;
+}
+
+// Wheel sieve with bucket sieving of large primes (Oliveira e Silva) (Parallelized Segmented Sieve)
+long bucket_sieve(long n)
+{
+    if (n < 7)
+        return wheel_sieve(n);
+
+    long n_primes;
+    long *primes = sieving_primes((long)sqrt(n), &n_primes);
+    long count = 3;  // 2, 3 and 5 are not on the wheel
+    count += bucket_count_range(0, n / 30 + 1, n, primes, n_primes);
+
+    free(primes);
+    return count;
+}
+
+/**
+ * Receives primes in increasing order, `count` at a time. Returning non-zero stops
+ * the enumeration early.
+ */
+typedef int (*prime_callback)(const uint64_t *primes, size_t count, void *arg);
+
+// Decoded primes of one segment, held in the reorder window until every earlier
+// segment has been handed out
+typedef struct
+{
+    uint64_t *primes;
+    size_t count, capacity;
+    long segment;  // Segment whose primes are in the slot, -1 while the slot is free
+} prime_slot_t;
 
+/**
+ * Replaces the slot's contents with the primes >= lo of the sieved wheel segment that
+ * holds bytes [lo_byte, lo_byte + len). Bytes are read 64 bits at a time; on a
+ * little-endian machine byte j of a word is bits 8j .. 8j + 7, so the set bits come
+ * out in increasing order.
+ */
+static void wheel_decode(const uint8_t *segment, long lo_byte, long len, long lo, prime_slot_t *slot)
+{
+    size_t need = wheel_popcount(segment, len);
+    if (need > slot->capacity)
+    {
+        slot->capacity = need;
+        slot->primes = realloc(slot->primes, need * sizeof(uint64_t));
+    }
+
+    slot->count = 0;
+    for (long k = 0; k < len; k += 8)
+    {
+        uint64_t word = 0;
+        memcpy(&word, segment + k, (len - k < 8) ? len - k : 8);
+        while (word)
+        {
+            int bit = __builtin_ctzll(word);
+            word &= word - 1;
+            uint64_t x = 30 * (uint64_t)(lo_byte + k + bit / 8) + wheel30[bit % 8];
+            if (x >= (uint64_t)lo)
+                slot->primes[slot->count++] = x;
+        }
+    }
+}
+
+// Primes 2, 3 and 5 (not on the wheel) that lie in [lo, hi]
+static size_t small_primes_in(long lo, long hi, uint64_t out[3])
+{
+    static const uint64_t small[3] = { 2, 3, 5 };
+    size_t count = 0;
     for (int i = 0; i < 3; i++)
     {
-        long n = input[i];
-        double start, end, time1, time2, time3;
+        if ((long)small[i] >= lo && (long)small[i] <= hi)
+            out[count++] = small[i];
+    }
+    return count;
+}
 
-        start = omp_get_wtime();
-        long result1 = cache_unfriendly_sieve(n);
-        end = omp_get_wtime();
-        time1 = end - start;
+// Reorder window shared by the threads of primes_range
+typedef struct
+{
+    prime_slot_t *slots;
+    long window;
+    long next_emit;  // Next segment to hand to the callback
+    int stop;
+    long emitted;
+    omp_lock_t lock;
+    prime_callback callback;
+    void *arg;
+} prime_window_t;
 
-        start = omp_get_wtime();
-        long result2 = cache_friendly_sieve(n);
-        end = omp_get_wtime();
-        time2 = end - start;
+/**
+ * Hands the finished segments at the head of the window to the callback, in order.
+ * One thread emits at a time: with wait == 0 the call gives up if another thread
+ * is emitting.
+ */
+static void window_drain(prime_window_t *w, int wait)
+{
+    if (wait)
+        omp_set_lock(&w->lock);
+    else if (!omp_test_lock(&w->lock))
+        return;
 
-        start = omp_get_wtime();
-        long result3 = parallel_sieve(n);
-        end = omp_get_wtime();
-        time3 = end - start;
+    for (;;)
+    {
+        prime_slot_t *slot = &w->slots[w->next_emit % w->window];
+        long segment;
+#pragma omp atomic read seq_cst
+        segment = slot->segment;
+        if (segment != w->next_emit)
+            break;
+
+        if (!w->stop && slot->count > 0)
+        {
+            w->emitted += slot->count;
+            if (w->callback(slot->primes, slot->count, w->arg))
+            {
+#pragma omp atomic write seq_cst
+                w->stop = 1;
+            }
+        }
 
-        printf("| %11ldM | %12ld (%.6f s)      | %12ld (%.6f s)      | %12ld (%.6f s)      |\n",
-               n / 1000000, result1, time1, result2, time2, result3, time3);
+#pragma omp atomic write seq_cst
+        slot->segment = -1;
+#pragma omp atomic write seq_cst
+        w->next_emit = segment + 1;
     }
 
-    printf("+---------------+----------------------------+----------------------------+----------------------------+\n");
+    omp_unset_lock(&w->lock);
+}
+
+/**
+ * Streams every prime in [lo, hi] to `callback` in increasing order, one segment's
+ * primes per call. Threads sieve segments in any order into a reorder window of two
+ * segments per thread, and finished segments are passed on strictly in order: the
+ * callback runs on one thread at a time, though not always the same one. A thread
+ * that gets `window` segments ahead of the oldest unfinished one waits.
+ *
+ * [lo, hi] is sieved directly (only primes up to sqrt(hi) are needed); memory is the
+ * window plus one segment per thread, whatever the size of the range.
+ *
+ * Returns the number of primes passed to the callback.
+ */
+long primes_range(long lo, long hi, prime_callback callback, void *arg)
+{
+    if (lo < 0)
+        lo = 0;
+
+    uint64_t small[3];
+    size_t n_small = small_primes_in(lo, hi, small);
+    if (n_small > 0 && callback(small, n_small, arg))
+        return n_small;
+    if (hi < 7)
+        return n_small;
+
+    long n_primes;
+    long *primes = sieving_primes((long)sqrt(hi), &n_primes);
+    long first_byte = lo / 30, end_byte = hi / 30 + 1, seg_bytes = bucket_segment_bytes();
+    long n_segs = (end_byte - first_byte + seg_bytes - 1) / seg_bytes, next_segment = 0;
+
+    prime_window_t w = { 0 };
+    w.window = 2L * omp_get_max_threads();
+    w.slots = calloc(w.window, sizeof(prime_slot_t));
+    for (long i = 0; i < w.window; i++)
+        w.slots[i].segment = -1;
+    w.emitted = n_small;
+    w.callback = callback;
+    w.arg = arg;
+    omp_init_lock(&w.lock);
+
+#pragma omp parallel
+    {
+        uint8_t *segment = malloc(seg_bytes);
+
+        for (;;)
+        {
+            long s, head;
+            int stop;
+#pragma omp atomic capture
+            s = next_segment++;
+#pragma omp atomic read seq_cst
+            stop = w.stop;
+            if (s >= n_segs || stop)
+                break;
+
+            // Slot s % window is free once the segment `window` places back has been emitted
+            for (;;)
+            {
+#pragma omp atomic read seq_cst
+                head = w.next_emit;
+#pragma omp atomic read seq_cst
+                stop = w.stop;
+                if (s < head + w.window || stop)
+                    break;
+                window_drain(&w, 0);
+                sched_yield();
+            }
+            if (stop)
+                break;
+
+            long lo_byte = first_byte + s * seg_bytes;
+            long len = (end_byte - lo_byte < seg_bytes) ? end_byte - lo_byte : seg_bytes;
+            prime_slot_t *slot = &w.slots[s % w.window];
+            wheel_sieve_segment(segment, lo_byte, len, hi, primes, n_primes);
+            wheel_decode(segment, lo_byte, len, lo, slot);
+#pragma omp atomic write seq_cst
+            slot->segment = s;
+
+            window_drain(&w, 0);
+        }
+
+        // Whoever finishes last emits what the others left behind
+        window_drain(&w, 1);
+        free(segment);
+    }
+
+    omp_destroy_lock(&w.lock);
+    for (long i = 0; i < w.window; i++)
+        free(w.slots[i].primes);
+    free(w.slots);
+    free(primes);
+    return w.emitted;
+}
+
+/**
+ * Pull-style enumeration for callers that fill their own buffer: prime_iter_next()
+ * copies up to `capacity` primes of [lo, hi] in increasing order and returns how many,
+ * 0 at the end. Segments are sieved one at a time on the calling thread.
+ */
+typedef struct
+{
+    long lo, hi, next_byte, end_byte, seg_bytes, n_primes;
+    long *primes;
+    uint8_t *segment;
+    prime_slot_t slot;  // Primes of the current segment not yet copied out start at pos
+    size_t pos;
+} prime_iter_t;
+
+void prime_iter_init(prime_iter_t *it, long lo, long hi)
+{
+    memset(it, 0, sizeof(*it));
+    it->lo = lo < 0 ? 0 : lo;
+    it->hi = hi;
+    it->seg_bytes = bucket_segment_bytes();
+    it->segment = malloc(it->seg_bytes);
+    it->primes = sieving_primes(hi >= 0 ? (long)sqrt(hi) : 0, &it->n_primes);
+    it->next_byte = it->lo / 30;
+    it->end_byte = (hi >= 7) ? hi / 30 + 1 : it->next_byte;
+
+    it->slot.primes = malloc(3 * sizeof(uint64_t));
+    it->slot.capacity = 3;
+    it->slot.count = small_primes_in(it->lo, hi, it->slot.primes);
+}
+
+size_t prime_iter_next(prime_iter_t *it, uint64_t *buffer, size_t capacity)
+{
+    size_t filled = 0;
+    while (filled < capacity)
+    {
+        if (it->pos == it->slot.count)
+        {
+            if (it->next_byte >= it->end_byte)
+                break;
+            long len = (it->end_byte - it->next_byte < it->seg_bytes) ? it->end_byte - it->next_byte : it->seg_bytes;
+            wheel_sieve_segment(it->segment, it->next_byte, len, it->hi, it->primes, it->n_primes);
+            wheel_decode(it->segment, it->next_byte, len, it->lo, &it->slot);
+            it->next_byte += len;
+            it->pos = 0;
+            continue;
+        }
+
+        size_t take = it->slot.count - it->pos;
+        if (take > capacity - filled)
+            take = capacity - filled;
+        memcpy(buffer + filled, it->slot.primes + it->pos, take * sizeof(uint64_t));
+        filled += take;
+        it->pos += take;
+    }
+    return filled;
+}
+
+void prime_iter_free(prime_iter_t *it)
+{
+    free(it->segment);
+    free(it->primes);
+    free(it->slot.primes);
+}
+
+// primes_range callback of primes_write_binary: appends the chunk, stops on a write error
+static int write_chunk(const uint64_t *primes, size_t count, void *arg)
+{
+    return fwrite(primes, sizeof(uint64_t), count, (FILE *)arg) != count;
+}
+
+/**
+ * Writes every prime in [lo, hi] to `path` as consecutive 64-bit integers in native
+ * byte order, one fwrite per segment through a 1 MB stdio buffer.
+ *
+ * Returns the number of primes written, or -1 if the file could not be written.
+ */
+long primes_write_binary(long lo, long hi, const char *path)
+{
+    FILE *file = fopen(path, "wb");
+    if (!file)
+        return -1;
+    setvbuf(file, NULL, _IOFBF, 1 << 20);
+
+    long count = primes_range(lo, hi, write_chunk, file);
+    int failed = ferror(file);
+    if (fclose(file) != 0 || failed)
+        return -1;
+    return count;
+}
+
+// Below this many entries a Lucy pass runs on one thread (a parallel region costs more)
+#define LUCY_PARALLEL_MIN 32768
+
+/**
+ * Counts the primes up to n without sieving them, by Lucy_Hedgehog's method, in
+ * O(n^(3/4)) time and O(sqrt n) memory.
+ *
+ * S(v) starts as the count of 2 ... v and is only needed at the O(sqrt n) values
+ * v = n / i. Each prime p <= sqrt n removes the numbers whose smallest factor is p:
+ *   S(v) -= S(v / p) - S(p - 1)   for every v >= p^2
+ * after which S(n) = pi(n). Values v <= r are kept in lo[v], values n / i in hi[i].
+ * Every pass over one prime is parallel; the base primes come from the segmented
+ * sieve (prime_iter).
+ */
+long lucy_pi(long n)
+{
+    if (n < 2)
+        return 0;
+
+    long r = (long)sqrt((double)n);
+    while (r * r > n)
+        r--;
+    while ((r + 1) * (r + 1) <= n)
+        r++;
+
+    uint32_t *lo = malloc((r + 1) * sizeof(uint32_t));
+    long *hi = malloc((r + 1) * sizeof(long));
+    long *tmp = malloc((r + 1) * sizeof(long));
+
+    // pi(r) < 1.26 r / ln r
+    uint64_t *primes = malloc((size_t)(1.26 * r / log(r + 2.0) + 16) * sizeof(uint64_t));
+    prime_iter_t it;
+    prime_iter_init(&it, 2, r);
+    size_t n_primes = 0, got;
+    while ((got = prime_iter_next(&it, primes + n_primes, 4096)) > 0)
+        n_primes += got;
+    prime_iter_free(&it);
+
+    lo[0] = 0;
+#pragma omp parallel for schedule(static)
+    for (long v = 1; v <= r; v++)
+    {
+        lo[v] = (uint32_t)(v - 1);
+        hi[v] = n / v - 1;
+    }
+
+    // n / (i * p) in double is exact below 2^50: the quotient is at least 1/n below the
+    // next integer, which is more than the rounding error
+    int exact_double = n < (1L << 50);
+    double nd = (double)n;
+
+    for (size_t k = 0; k < n_primes; k++)
+    {
+        long p = (long)primes[k], p2 = p * p;
+        uint32_t sp = (uint32_t)k;  // S(p - 1) = pi(p - 1)
+        long active = (n / p2 < r) ? n / p2 : r;
+        long from_hi = (r / p < active) ? r / p : active;
+
+        // hi[i] with i * p <= r reads hi[i * p], which this pass also updates: read first
+#pragma omp parallel for schedule(static) if (from_hi > LUCY_PARALLEL_MIN)
+        for (long i = 1; i <= from_hi; i++)
+            tmp[i] = hi[i * p];
+#pragma omp parallel for schedule(static) if (from_hi > LUCY_PARALLEL_MIN)
+        for (long i = 1; i <= from_hi; i++)
+            hi[i] -= tmp[i] - sp;
+
+        // The rest reads lo[n / (i * p)], which is updated after hi
+        if (exact_double)
+        {
+#pragma omp parallel for schedule(static) if (active - from_hi > LUCY_PARALLEL_MIN)
+            for (long i = from_hi + 1; i <= active; i++)
+                hi[i] -= lo[(long)(nd / (double)(i * p))] - sp;
+        }
+        else
+        {
+#pragma omp parallel for schedule(static) if (active - from_hi > LUCY_PARALLEL_MIN)
+            for (long i = from_hi + 1; i <= active; i++)
+                hi[i] -= lo[n / (i * p)] - sp;
+        }
+
+        if (p2 > r)
+            continue;
+
+        // lo[v] for v in [p^2, r] reads lo[v / p]. Above r / p those reads are below every
+        // write, so that part runs in parallel, one run of p values per quotient q
+        long q_top = r / p, v0 = (p2 > q_top + 1) ? p2 : q_top + 1;
+#pragma omp parallel for schedule(static) if (r - v0 > LUCY_PARALLEL_MIN)
+        for (long q = v0 / p; q <= q_top; q++)
+        {
+            long a = (q * p > v0) ? q * p : v0, b = (q * p + p - 1 < r) ? q * p + p - 1 : r;
+            uint32_t d = lo[q] - sp;
+            for (long v = a; v <= b; v++)
+                lo[v] -= d;
+        }
+        // Below r / p (only for p^3 <= r) the reads overlap the writes: descending, one thread
+        for (long v = v0 - 1; v >= p2; v--)
+            lo[v] -= lo[v / p] - sp;
+    }
+
+    long count = hi[1];
+    free(lo);
+    free(hi);
+    free(tmp);
+    free(primes);
+    return count;
+}
+
+#ifndef SIEVE_NO_MAIN
+
+// Sieves of the table, in column order, and the largest input each one runs
+static const struct
+{
+    const char *name;
+    long (*sieve)(long n);
+    long max_n;
+} sieves[] = {
+    { "Cache Unfriendly", cache_unfriendly_sieve, BYTE_SIEVE_MAX },
+    { "Cache Friendly", cache_friendly_sieve, BYTE_SIEVE_MAX },
+    { "Parallel", parallel_sieve, BYTE_SIEVE_MAX },
+    { "Arena Segmented", arena_sieve, BYTE_SIEVE_MAX },
+    { "Arena Presieved", presieved_sieve, BYTE_SIEVE_MAX },
+    { "Wheel Bitset", wheel_sieve, WHEEL_SIEVE_MAX },
+    { "Bucket Sieve", bucket_sieve, 1L << 62 },
+    { "Lucy pi(x)", lucy_pi, 1L << 62 },
+};
+#define NUM_SIEVES (int)(sizeof(sieves) / sizeof(sieves[0]))
+
+static void print_rule(void)
+{
+    printf("+---------------+");
+    for (int j = 0; j < NUM_SIEVES; j++)
+        printf("------------------------------+");
+    printf("\n");
+}
+
+// One table cell: prime count and time, or "-" when the sieve was not run (count < 0)
+static void print_cell(long count, double time)
+{
+    if (count < 0)
+        printf(" %28s |", "-");
+    else
+        printf(" %12ld (%10.6f s)  |", count, time);
+}
+
+// Running summary of a prime stream; `ordered` stays 1 while every prime exceeds the last
+typedef struct
+{
+    long count;
+    uint64_t first, last;
+    int ordered;
+} prime_summary_t;
+
+static int summarize_chunk(const uint64_t *primes, size_t count, void *arg)
+{
+    prime_summary_t *summary = arg;
+    if (summary->count == 0)
+        summary->first = primes[0];
+    else if (primes[0] <= summary->last)
+        summary->ordered = 0;
+    for (size_t i = 1; i < count; i++)
+    {
+        if (primes[i] <= primes[i - 1])
+            summary->ordered = 0;
+    }
+    summary->last = primes[count - 1];
+    summary->count += count;
     return 0;
 }
+
+/**
+ * Streams the primes of [lo, hi] with primes_range, prints a summary checked against the
+ * sequential prime_iter_next, and writes them to `path` as raw 64-bit integers when a
+ * path is given.
+ */
+static int enumerate_primes(long lo, long hi, const char *path)
+{
+    prime_summary_t summary = { 0, 0, 0, 1 };
+    double start = omp_get_wtime();
+    primes_range(lo, hi, summarize_chunk, &summary);
+    double time = omp_get_wtime() - start;
+
+    // The sequential iterator must yield the same primes in the same order
+    prime_summary_t check = { 0, 0, 0, 1 };
+    prime_iter_t it;
+    uint64_t buffer[4096];
+    size_t got;
+    prime_iter_init(&it, lo, hi);
+    while ((got = prime_iter_next(&it, buffer, 4096)) > 0)
+        summarize_chunk(buffer, got, &check);
+    prime_iter_free(&it);
+    int ok = summary.ordered && summary.count == check.count && summary.first == check.first && summary.last == check.last;
+
+    printf("\nPrimes in [%ld, %ld]: %ld (%.6f s, %d threads)\n", lo, hi, summary.count, time, omp_get_max_threads());
+    if (summary.count > 0)
+        printf("First %llu, last %llu, %s\n", (unsigned long long)summary.first, (unsigned long long)summary.last,
+               summary.ordered ? "in increasing order" : "OUT OF ORDER");
+    printf("Check against the sequential iterator: %s\n", ok ? "ok" : "MISMATCH");
+
+    if (path)
+    {
+        start = omp_get_wtime();
+        long written = primes_write_binary(lo, hi, path);
+        time = omp_get_wtime() - start;
+        if (written < 0)
+        {
+            fprintf(stderr, "Error: cannot write %s\n", path);
+            return 1;
+        }
+        printf("Wrote %ld primes to %s (%.6f s, %.1f MB/s)\n", written, path, time, written * 8.0 / time * 1e-6);
+    }
+
+    return !ok;
+}
+
+int main(int argc, char *argv[])
+{
+    // ./sieve primes LO HI [FILE] lists the primes of a range instead of counting
+    if (argc > 3 && strcmp(argv[1], "primes") == 0)
+        return enumerate_primes((long)strtod(argv[2], NULL), (long)strtod(argv[3], NULL), argc > 4 ? argv[4] : NULL);
+
+    // ./sieve pi X counts the primes up to X with Lucy's method only, e.g. ./sieve pi 1e13
+    if (argc > 2 && strcmp(argv[1], "pi") == 0)
+    {
+        long x = (long)strtod(argv[2], NULL);
+        double start = omp_get_wtime();
+        long count = lucy_pi(x);
+        printf("pi(%ld) = %ld (%.6f s)\n", x, count, omp_get_wtime() - start);
+        return 0;
+    }
+
+    // An optional argument replaces the list of sizes, e.g. ./sieve 1e12
+    long input[6] = {1000000, 10000000, 100000000, 1000000000, 10000000000, 100000000000};
+    int num_inputs = 6;
+    if (argc > 1)
+    {
+        input[0] = (long)strtod(argv[1], NULL);
+        num_inputs = 1;
+    }
+
+    long reference[6] = {-1, -1, -1, -1, -1, -1};
+    int mismatches = 0;
+
+    printf("\nSieve of Eratosthenes - Prime Number Counting\n");
+    printf("============================================\n\n");
+
+    print_rule();
+    printf("|   Input Size  |");
+    for (int j = 0; j < NUM_SIEVES; j++)
+        printf(" %22s (sec) |", sieves[j].name);
+    printf("\n");
+    print_rule();
+
+    for (int i = 0; i < num_inputs; i++)
+    {
+        long n = input[i];
+        printf("| %12ldM |", n / 1000000);
+
+        // Every sieve runs up to its own limit; larger inputs show "-"
+        for (int j = 0; j < NUM_SIEVES; j++)
+        {
+            long result = -1;
+            double start = omp_get_wtime();
+            if (n <= sieves[j].max_n)
+                result = sieves[j].sieve(n);
+            double end = omp_get_wtime();
+            print_cell(result, end - start);
+            fflush(stdout);
+
+            // Every column must agree with the first one that ran
+            if (result >= 0 && reference[i] < 0)
+                reference[i] = result;
+            else if (result >= 0 && result != reference[i])
+                mismatches++;
+        }
+        printf("\n");
+    }
+
+    print_rule();
+
+    if (mismatches > 0)
+        printf("\n%d count(s) differ from the first column of their row\n", mismatches);
+    return mismatches > 0;
+}
+
+#endif  // SIEVE_NO_MAIN
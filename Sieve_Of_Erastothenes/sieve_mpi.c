@@ -0,0 +1,190 @@
+// Distributed Sieve of Eratosthenes using MPI + OpenMP
+//
+// Every rank computes the sieving primes up to sqrt(n) itself (they are tiny next to
+// the range), sieves one contiguous block of the mod-30 wheel bitset of [0, n] with
+// the node-local OpenMP bucket sieve from sieve_erastothenes.c, and the per-rank
+// counts are summed on rank 0 with MPI_Reduce.
+//
+// Blocks are balanced by estimated cost rather than by length: the start of the
+// range is cheaper to sieve because a prime p only crosses off from p^2 onwards.
+//
+// Compilation Command:
+//   mpicc -O3 -march=native -fopenmp -o sieve_mpi sieve_mpi.c -lm
+//
+// Run (one Linux box is fine; OMP_NUM_THREADS sets threads per rank):
+//   mpirun -np 4 ./sieve_mpi [strong_n] [weak_n]
+//
+#define SIEVE_NO_MAIN
+#include "sieve_erastothenes.c"
+
+#include <mpi.h>
+
+#define ROOT 0               // Rank that prints the tables
+#define WHEEL_BYTE_COST 2.0  // Fixed cost of one bitset byte (init + popcount), in crossed-off bits
+
+/**
+ * Splits bytes [0, bytes) of the wheel bitset into `parts` blocks of equal estimated
+ * cost and stores the first byte of block r in bounds[r] (bounds[parts] = bytes).
+ *
+ * A sieving prime p >= 7 crosses off 8 / p bits per byte from byte p^2 / 30 on, so
+ * the cost per byte is constant between consecutive p^2 / 30 and the cumulative
+ * cost is piecewise linear with a breakpoint per prime.
+ */
+static void cost_split(long bytes, const long *primes, long n_primes, int parts, long *bounds)
+{
+    long first = 0;
+    while (first < n_primes && primes[first] < 7)
+        first++;
+
+    // Total cost: integrate the piecewise constant density over [0, bytes)
+    double total = 0, density = WHEEL_BYTE_COST;
+    long x = 0;
+    for (long i = first; i <= n_primes; i++)
+    {
+        long edge = (i < n_primes && primes[i] * primes[i] / 30 < bytes) ? primes[i] * primes[i] / 30 : bytes;
+        total += density * (edge - x);
+        x = edge;
+        if (edge == bytes)
+            break;
+        density += 8.0 / primes[i];
+    }
+
+    // Walk the same pieces again and cut wherever the running cost passes r * total / parts
+    double cost = 0;
+    long i = first;
+    density = WHEEL_BYTE_COST;
+    x = 0;
+    bounds[0] = 0;
+    for (int r = 1; r < parts; r++)
+    {
+        double target = total * r / parts;
+        for (;;)
+        {
+            long edge = (i < n_primes && primes[i] * primes[i] / 30 < bytes) ? primes[i] * primes[i] / 30 : bytes;
+            if (cost + density * (edge - x) >= target || edge == bytes)
+            {
+                long cut = x + (long)((target - cost) / density);
+                bounds[r] = (cut < edge) ? cut : edge;
+                break;
+            }
+            cost += density * (edge - x);
+            x = edge;
+            density += 8.0 / primes[i++];
+        }
+        if (bounds[r] < bounds[r - 1])
+            bounds[r] = bounds[r - 1];
+    }
+    bounds[parts] = bytes;
+}
+
+/**
+ * Counts the primes up to n on the ranks of `comm`. The count is valid on rank 0
+ * of comm; `time` receives the elapsed time of the slowest rank and `imbalance`
+ * the slowest rank's time over the mean (1.0 = perfectly balanced).
+ */
+static long distributed_sieve(MPI_Comm comm, long n, double *time, double *imbalance)
+{
+    int rank, size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+
+    MPI_Barrier(comm);
+    double start = MPI_Wtime();
+
+    long n_primes, bytes = n / 30 + 1;
+    long *primes = sieving_primes((long)sqrt(n), &n_primes);
+    long *bounds = malloc((size + 1) * sizeof(long));
+    cost_split(bytes, primes, n_primes, size, bounds);
+
+    long count = bucket_count_range(bounds[rank], bounds[rank + 1], n, primes, n_primes);
+    if (rank == ROOT)
+        count += (n >= 2) + (n >= 3) + (n >= 5);  // 2, 3 and 5 are not on the wheel
+
+    double elapsed = MPI_Wtime() - start, max_elapsed, sum_elapsed;
+    long total = 0;
+    MPI_Reduce(&count, &total, 1, MPI_LONG, MPI_SUM, ROOT, comm);
+    MPI_Reduce(&elapsed, &max_elapsed, 1, MPI_DOUBLE, MPI_MAX, ROOT, comm);
+    MPI_Reduce(&elapsed, &sum_elapsed, 1, MPI_DOUBLE, MPI_SUM, ROOT, comm);
+
+    *time = max_elapsed;
+    *imbalance = max_elapsed * size / sum_elapsed;
+    free(bounds);
+    free(primes);
+    return total;
+}
+
+/**
+ * Runs the distributed sieve on the first p ranks of MPI_COMM_WORLD for every p in
+ * 1, 2, 4, ... (plus the full world size) and prints one table row per p.
+ *
+ * @param base_n: Sieve limit for p = 1.
+ * @param weak: Non-zero to grow n with p so the range per rank (n / p) stays constant.
+ */
+static void scaling_table(long base_n, int weak)
+{
+    int rank, world;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &world);
+
+    if (rank == ROOT)
+    {
+        printf("\n%s scaling (base N = %ld, %d OpenMP threads per rank)\n",
+               weak ? "Weak" : "Strong", base_n, omp_get_max_threads());
+        printf("+------------+----------------+--------------+------------+------------+------------+\n");
+        printf("| %10s | %14s | %12s | %10s | %10s | %10s |\n", "Procs", "N", "Primes", "Time (s)", "Imbalance", "Efficiency");
+        printf("+------------+----------------+--------------+------------+------------+------------+\n");
+    }
+
+    double t1 = 0;
+    for (int p = 1; p <= world; p = (p * 2 > world && p < world) ? world : p * 2)
+    {
+        long n = weak ? base_n * p : base_n;
+        MPI_Comm sub;
+        MPI_Comm_split(MPI_COMM_WORLD, rank < p ? 0 : MPI_UNDEFINED, rank, &sub);
+
+        long count = 0;
+        double t = 0, imbalance = 0;
+        if (sub != MPI_COMM_NULL)
+        {
+            count = distributed_sieve(sub, n, &t, &imbalance);
+            MPI_Comm_free(&sub);
+        }
+        MPI_Barrier(MPI_COMM_WORLD);
+
+        if (rank == ROOT)
+        {
+            if (p == 1)
+                t1 = t;
+            // Strong: T1 / (p * Tp); weak: T1 / Tp
+            double efficiency = weak ? t1 / t : t1 / (p * t);
+            printf("| %10d | %14ld | %12ld | %10.6f | %10.3f | %9.1f%% |\n",
+                   p, n, count, t, imbalance, 100.0 * efficiency);
+        }
+    }
+
+    if (rank == ROOT)
+        printf("+------------+----------------+--------------+------------+------------+------------+\n");
+}
+
+int main(int argc, char *argv[])
+{
+    // The OpenMP sieve runs between MPI calls made by the main thread only
+    int provided, rank;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    if (provided < MPI_THREAD_FUNNELED)
+    {
+        if (rank == ROOT)
+            fprintf(stderr, "Error: the MPI library grants thread level %d, but %s needs MPI_THREAD_FUNNELED\n", provided, argv[0]);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    long strong_n = argc > 1 ? (long)strtod(argv[1], NULL) : 10000000000L;
+    long weak_n = argc > 2 ? (long)strtod(argv[2], NULL) : 2000000000L;
+
+    scaling_table(strong_n, 0);
+    scaling_table(weak_n, 1);
+
+    MPI_Finalize();
+    return 0;
+}